@@ -0,0 +1,396 @@
+#ifndef ASYNC_CBUFFER_H
+#define ASYNC_CBUFFER_H
+
+#if __cplusplus < 202002L
+#error "async_cbuffer.h richiede C++20 (coroutine)"
+#endif
+
+#include <cerrno>
+#include <coroutine>
+#include <cstdint>      // std::uint64_t
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <system_error> // std::system_error
+#include <utility>      // std::move
+#include <vector>
+#include <sys/eventfd.h>
+#include <unistd.h>     // read, write, close
+#include "cbuffer.h"
+
+/**
+ * @file async_cbuffer.h
+ * @brief Dichiarazione della classe async_cbuffer
+ *
+ * cbuffer thread-safe per consumatori a coroutine C++20: co_await ring.pop() e
+ * co_await ring.pop_n(k) sospendono la coroutine finché il buffer è vuoto, senza polling.
+ * Per l'integrazione con un event loop (epoll) il buffer può esporre due eventfd:
+ * il primo è leggibile finché ci sono elementi da consegnare a coroutine in attesa,
+ * il secondo finché il buffer non è pieno.
+**/
+
+/**
+ * @brief Modalità di ripresa dei consumatori sospesi
+ *
+ * inline_resume: il produttore riprende il consumatore dentro insert, nel proprio thread
+ *                (pipeline in un solo thread)
+ * eventfd:       insert segnala readable_fd(); l'event loop, quando il descrittore è pronto,
+ *                chiama resume_waiters() e riprende i consumatori nel proprio thread
+**/
+enum class resume_mode {
+    inline_resume,
+    eventfd
+};
+
+template <class T>
+class async_cbuffer {
+    struct waiter;
+
+    public:
+        typedef typename cbuffer<T>::size_type size_type;
+
+        /**
+         * @brief Awaitable di pop()
+        **/
+        class pop_awaiter {
+            public:
+                bool await_ready() {
+                    return _ring->try_take(_w);
+                }
+
+                bool await_suspend(std::coroutine_handle<> handle) {
+                    _w.handle = handle;
+                    return _ring->suspend(_w);
+                }
+
+                T await_resume() {
+                    return std::move(*_w.one);
+                }
+
+            private:
+                async_cbuffer *_ring;
+                waiter _w;
+
+                friend class async_cbuffer;
+
+                explicit pop_awaiter(async_cbuffer *ring) : _ring(ring), _w(0) {
+                }
+        };
+
+        /**
+         * @brief Awaitable di pop_n()
+        **/
+        class pop_n_awaiter {
+            public:
+                bool await_ready() {
+                    return _ring->try_take(_w);
+                }
+
+                bool await_suspend(std::coroutine_handle<> handle) {
+                    _w.handle = handle;
+                    return _ring->suspend(_w);
+                }
+
+                std::vector<T> await_resume() {
+                    return std::move(_w.many);
+                }
+
+            private:
+                async_cbuffer *_ring;
+                waiter _w;
+
+                friend class async_cbuffer;
+
+                pop_n_awaiter(async_cbuffer *ring, size_type k) : _ring(ring), _w(k) {
+                }
+        };
+
+        /**
+         * @brief Costruttore secondario
+         *
+         * @param capacity Capacità del buffer
+         * @param mode Modalità di ripresa dei consumatori; con resume_mode::eventfd vengono
+         *        creati i descrittori readable_fd() e writable_fd()
+         * @throw std::system_error se la creazione degli eventfd fallisce
+        **/
+        explicit async_cbuffer(size_type capacity, resume_mode mode = resume_mode::inline_resume)
+                : _cb(capacity), _mode(mode), _readable_fd(-1), _writable_fd(-1), _readable(false),
+                  _notifications(0) {
+            if(mode == resume_mode::eventfd) {
+                _readable_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+                if(_readable_fd < 0)
+                    throw std::system_error(errno, std::generic_category(), "eventfd");
+                _writable_fd = eventfd(capacity != 0 ? 1 : 0, EFD_CLOEXEC | EFD_NONBLOCK);
+                if(_writable_fd < 0) {
+                    const int e = errno;
+                    close(_readable_fd);
+                    throw std::system_error(e, std::generic_category(), "eventfd");
+                }
+            }
+        }
+
+        /**
+         * @brief Distruttore
+         *
+         * Chiude gli eventfd. Le coroutine ancora sospese non vengono riprese:
+         * il buffer deve sopravvivere ai propri consumatori.
+        **/
+        ~async_cbuffer() {
+            if(_readable_fd >= 0)
+                close(_readable_fd);
+            if(_writable_fd >= 0)
+                close(_writable_fd);
+        }
+
+        /**
+         * @brief Inserimento di un elemento
+         *
+         * Se il buffer è pieno l'elemento più vecchio viene sovrascritto, come cbuffer::insert.
+         * Se una coroutine attende, in modalità inline_resume riceve l'elemento e viene ripresa
+         * prima del ritorno; in modalità eventfd il buffer diventa leggibile.
+         * @param value Un elemento da inserire
+        **/
+        void insert(const T &value) {
+            T copy(value);
+            insert(std::move(copy));
+        }
+
+        void insert(T &&value) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            push(lock, std::move(value));
+        }
+
+        /**
+         * @brief Inserimento senza sovrascrittura
+         *
+         * @param value Un elemento da inserire
+         * @return true se l'elemento è stato inserito, false se il buffer è pieno
+        **/
+        bool try_insert(const T &value) {
+            T copy(value);
+            std::unique_lock<std::mutex> lock(_mutex);
+            if(_cb.size() == _cb.capacity())
+                return false;
+            push(lock, std::move(copy));
+            return true;
+        }
+
+        /**
+         * @brief Estrazione asincrona di un elemento
+         *
+         * co_await ring.pop() restituisce l'elemento in testa, sospendendo la coroutine
+         * finché il buffer è vuoto. Le coroutine in attesa sono servite in ordine di arrivo.
+        **/
+        pop_awaiter pop() {
+            return pop_awaiter(this);
+        }
+
+        /**
+         * @brief Estrazione asincrona di un blocco di elementi
+         *
+         * co_await ring.pop_n(k) restituisce da 1 a k elementi, dal più vecchio, sospendendo
+         * la coroutine finché il buffer è vuoto. Con resume_mode::eventfd gli inserimenti
+         * arrivati prima della ripresa vengono consegnati insieme.
+         * @param k Numero massimo di elementi (almeno 1)
+        **/
+        pop_n_awaiter pop_n(size_type k) {
+            return pop_n_awaiter(this, k != 0 ? k : 1);
+        }
+
+        /**
+         * @brief Estrazione non bloccante
+         *
+         * @param value Reference in cui viene spostato l'elemento estratto
+         * @return true se un elemento è stato estratto, false se il buffer è vuoto
+        **/
+        bool try_pop(T &value) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            const edges e = before();
+            if(!_cb.try_pop(value))
+                return false;
+            after(e);
+            return true;
+        }
+
+        /**
+         * @brief Ripresa dei consumatori in attesa (modalità eventfd)
+         *
+         * Da chiamare nel thread dell'event loop quando readable_fd() è pronto: consegna gli
+         * elementi presenti alle coroutine sospese, in ordine di arrivo, e le riprende.
+         * @return Il numero di coroutine riprese
+        **/
+        unsigned int resume_waiters() {
+            std::vector<std::coroutine_handle<> > ready;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                const edges e = before();
+                while(!_waiters.empty() && _cb.size() != 0) {
+                    take(*_waiters.front());
+                    ready.push_back(_waiters.front()->handle);
+                    _waiters.pop_front();
+                }
+                after(e);
+            }
+            for(std::coroutine_handle<> h : ready)
+                h.resume();
+            return static_cast<unsigned int>(ready.size());
+        }
+
+        /**
+         * @brief Descrittore leggibile finché una coroutine attende elementi presenti
+         *
+         * eventfd da registrare (in lettura, level-triggered) nell'event loop. Viene segnalato
+         * una sola volta quando il buffer contiene elementi e almeno una coroutine è sospesa,
+         * quindi una raffica di insert produce una sola notifica, e azzerato quando il buffer
+         * si svuota o non resta nessuna coroutine in attesa: gli elementi che nessuno attende
+         * non tengono il descrittore leggibile e l'event loop non gira a vuoto. Viene
+         * riattivato alla sospensione successiva. Non va letto dall'utente.
+         * @return Il descrittore, -1 se il buffer non è in modalità eventfd
+        **/
+        int readable_fd() const {
+            return _readable_fd;
+        }
+
+        /**
+         * @brief Descrittore leggibile finché il buffer non è pieno
+         *
+         * Segnalato quando il buffer passa da pieno a non pieno e azzerato quando si riempie,
+         * per i produttori che usano try_insert.
+         * @return Il descrittore, -1 se il buffer non è in modalità eventfd
+        **/
+        int writable_fd() const {
+            return _writable_fd;
+        }
+
+        /**
+         * @brief Notifiche inviate sugli eventfd
+         *
+         * @return Il numero di scritture e azzeramenti eseguiti sui descrittori
+        **/
+        unsigned long notifications() const {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _notifications;
+        }
+
+        size_type size() const {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _cb.size();
+        }
+
+        size_type capacity() const {
+            return _cb.capacity();
+        }
+
+    private:
+        //Stato di una coroutine sospesa, contenuto nel suo awaitable
+        struct waiter {
+            std::coroutine_handle<> handle;
+            size_type want;          // elementi richiesti da pop_n, 0 per pop
+            std::optional<T> one;
+            std::vector<T> many;
+
+            explicit waiter(size_type k) : handle(), want(k), one(), many() {
+            }
+        };
+
+        //Pieno prima di una modifica
+        struct edges {
+            bool full;
+        };
+
+        //Non copiabile: contiene un mutex e i descrittori
+        async_cbuffer(const async_cbuffer &other);
+        async_cbuffer &operator=(const async_cbuffer &other);
+
+        cbuffer<T> _cb;
+        resume_mode _mode;
+        int _readable_fd;
+        int _writable_fd;
+        bool _readable;   // readable_fd() segnalato
+        unsigned long _notifications;
+        std::deque<waiter*> _waiters;
+        mutable std::mutex _mutex;
+
+        //Inserimento sotto lock; in modalità inline_resume riprende il primo consumatore in attesa
+        void push(std::unique_lock<std::mutex> &lock, T &&value) {
+            const edges e = before();
+            _cb.insert(std::move(value));
+            after(e);
+            if(_mode == resume_mode::inline_resume && !_waiters.empty()) {
+                waiter *w = _waiters.front();
+                _waiters.pop_front();
+                take(*w);
+                lock.unlock();
+                w->handle.resume();
+            }
+        }
+
+        //Consegna a w gli elementi in testa (il buffer non deve essere vuoto)
+        void take(waiter &w) {
+            if(w.want == 0) {
+                w.one.emplace(_cb.pop());
+                return;
+            }
+            const size_type n = (w.want < _cb.size()) ? w.want : _cb.size();
+            w.many.reserve(n);
+            for(size_type i = 0; i < n; i++)
+                w.many.push_back(_cb.pop());
+        }
+
+        //await_ready: consegna subito se ci sono elementi e nessuno attende prima di noi
+        bool try_take(waiter &w) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if(_cb.size() == 0 || !_waiters.empty())
+                return false;
+            const edges e = before();
+            take(w);
+            after(e);
+            return true;
+        }
+
+        //await_suspend: ricontrolla sotto lock, altrimenti accoda la coroutine
+        bool suspend(waiter &w) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if(_cb.size() != 0 && _waiters.empty()) {
+                const edges e = before();
+                take(w);
+                after(e);
+                return false;
+            }
+            const edges e = before();
+            _waiters.push_back(&w);
+            after(e);
+            return true;
+        }
+
+        edges before() const {
+            const edges e = {_cb.size() == _cb.capacity()};
+            return e;
+        }
+
+        //Segnala readable_fd() solo se ci sono elementi e coroutine in attesa, writable_fd()
+        //solo nei passaggi pieno/non pieno
+        void after(const edges &e) {
+            if(_readable_fd < 0)
+                return;
+            const bool readable = (_cb.size() != 0 && !_waiters.empty());
+            if(readable != _readable) {
+                signal(_readable_fd, readable);
+                _readable = readable;
+            }
+            const bool full = (_cb.size() == _cb.capacity());
+            if(e.full != full)
+                signal(_writable_fd, !full);
+        }
+
+        void signal(int fd, bool ready) {
+            std::uint64_t n = 1;
+            if(ready)
+                (void)!write(fd, &n, sizeof(n));
+            else
+                (void)!read(fd, &n, sizeof(n));
+            _notifications++;
+        }
+};
+
+#endif
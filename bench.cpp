@@ -0,0 +1,2017 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <new>
+#include <numeric>
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include "cbuffer.h"
+#include "person.h"
+#include "spsc_cbuffer.h"
+#include "mpmc_cbuffer.h"
+#include "mirrored_cbuffer.h"
+#include "persistent_cbuffer.h"
+#include "shm_cbuffer.h"
+#include "hugepage_resource.h"
+#include "blocking_cbuffer.h"
+#include "window_cbuffer.h"
+#include "cbuffer_algo.h"
+#include "cbuffer_parallel.h"
+#include "soa_cbuffer.h"
+#include "record_cbuffer.h"
+#include "async_cbuffer.h"
+#include "broadcast_cbuffer.h"
+#include <sys/epoll.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sstream>
+#include <csignal>
+#include <sys/wait.h>
+
+/**
+ * @file bench.cpp
+ * @brief Benchmark dei buffer circolari
+ *
+ * Ogni benchmark è una funzione senza parametri registrata nella tabella benches.
+ * Senza argomenti vengono eseguiti tutti, altrimenti solo quelli nominati.
+ * Con --csv=FILE e --json=FILE i risultati (ns/op, op/s, allocazioni/op) vengono
+ * anche scritti in FILE, per il confronto automatico tra versioni.
+**/
+
+typedef std::chrono::steady_clock bench_clock;
+
+/**
+ * Contatore globale delle allocazioni sullo heap, incrementato dalle versioni sostitutive
+ * di operator new. Sono sostituite tutte le forme (array, nothrow, allineate) e le
+ * corrispondenti operator delete, così ogni coppia new/delete usa malloc/free in modo coerente.
+**/
+static std::atomic<unsigned long> allocations(0);
+
+//Allocazione contata; align == 0 per l'allineamento di default. Restituisce 0 se fallisce.
+static void *counted_alloc(std::size_t n, std::size_t align) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if(n == 0)
+        n = 1;
+    if(align <= alignof(std::max_align_t))
+        return std::malloc(n);
+    return std::aligned_alloc(align, (n + align - 1) / align * align);
+}
+
+static void *counted_alloc_or_throw(std::size_t n, std::size_t align) {
+    if(void *p = counted_alloc(n, align))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t n) {
+    return counted_alloc_or_throw(n, 0);
+}
+
+void *operator new[](std::size_t n) {
+    return counted_alloc_or_throw(n, 0);
+}
+
+void *operator new(std::size_t n, std::align_val_t a) {
+    return counted_alloc_or_throw(n, static_cast<std::size_t>(a));
+}
+
+void *operator new[](std::size_t n, std::align_val_t a) {
+    return counted_alloc_or_throw(n, static_cast<std::size_t>(a));
+}
+
+void *operator new(std::size_t n, const std::nothrow_t &) noexcept {
+    return counted_alloc(n, 0);
+}
+
+void *operator new[](std::size_t n, const std::nothrow_t &) noexcept {
+    return counted_alloc(n, 0);
+}
+
+void *operator new(std::size_t n, std::align_val_t a, const std::nothrow_t &) noexcept {
+    return counted_alloc(n, static_cast<std::size_t>(a));
+}
+
+void *operator new[](std::size_t n, std::align_val_t a, const std::nothrow_t &) noexcept {
+    return counted_alloc(n, static_cast<std::size_t>(a));
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) noexcept {
+    std::free(p);
+}
+
+/**
+ * @brief Risultato di una misura
+ *
+ * Raccolto da report per l'output in formato CSV o JSON.
+**/
+struct bench_result {
+    std::string bench;
+    std::string name;
+    unsigned long ops;
+    double ns_per_op;
+    double ops_per_s;
+    double allocs_per_op;
+};
+
+static std::vector<bench_result> results;
+static std::string current_bench;
+static unsigned long alloc_mark = 0;
+
+/**
+ * @brief Inizio di una misura
+ *
+ * Azzera il conteggio delle allocazioni della misura.
+ * @return L'istante di inizio
+**/
+static bench_clock::time_point start_timer() {
+    alloc_mark = allocations.load();
+    return bench_clock::now();
+}
+
+//Nanosecondi trascorsi da start
+static double elapsed_ns(bench_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(bench_clock::now() - start).count();
+}
+
+/**
+ * @brief Stampa di un risultato
+ *
+ * Stampa il tempo per operazione, il throughput e le allocazioni per operazione
+ * di un benchmark, e lo aggiunge ai risultati.
+ * @param name Nome della misura
+ * @param ops Numero di operazioni eseguite
+ * @param ns Durata della misura in nanosecondi
+**/
+static void report_ns(const std::string &name, unsigned long ops, double ns) {
+    const double allocs = double(allocations.load() - alloc_mark) / ops;
+    const bench_result r = {current_bench, name, ops, ns / ops, ops * 1e9 / ns, allocs};
+    std::cout << name << ": " << r.ns_per_op << " ns/op, " << r.ops_per_s << " op/s, "
+              << r.allocs_per_op << " alloc/op" << std::endl;
+    results.push_back(r);
+}
+
+/**
+ * @brief Stampa di un risultato
+ *
+ * @param name Nome della misura
+ * @param ops Numero di operazioni eseguite
+ * @param start Istante di inizio della misura (start_timer)
+**/
+static void report(const std::string &name, unsigned long ops, bench_clock::time_point start) {
+    report_ns(name, ops, elapsed_ns(start));
+}
+
+/**
+ * @brief Verifica di correttezza
+ *
+ * Interrompe il benchmark se una condizione non è rispettata.
+**/
+static void check(bool condition, const char *what) {
+    if(!condition) {
+        std::cerr << "bench: verifica fallita: " << what << std::endl;
+        std::exit(1);
+    }
+}
+
+/**
+ * @brief cbuffer protetto da mutex
+ *
+ * Riferimento per il confronto con le code lock-free: stessa interfaccia try_push/try_pop.
+**/
+template <typename T>
+struct locked_cbuffer {
+    std::mutex m;
+    cbuffer<T> cb;
+
+    explicit locked_cbuffer(typename cbuffer<T>::size_type capacity) : cb(capacity) {}
+
+    bool try_push(const T &value) {
+        std::lock_guard<std::mutex> lock(m);
+        if(cb.size() == cb.capacity())
+            return false;
+        cb.insert(value);
+        return true;
+    }
+
+    bool try_pop(T &value) {
+        std::lock_guard<std::mutex> lock(m);
+        if(cb.size() == 0)
+            return false;
+        value = cb[0];
+        cb.remove();
+        return true;
+    }
+};
+
+/**
+ * @brief Trasferimento produttore/consumatore
+ *
+ * Un thread inserisce i valori 0..n-1, un altro li estrae verificando che
+ * arrivino tutti e nell'ordine di inserimento (stress test FIFO).
+**/
+template <typename Q>
+static void run_spsc(const std::string &name, Q &q, unsigned long n) {
+    bench_clock::time_point start = start_timer();
+    std::thread producer([&q, n]() {
+        for(unsigned long i = 0; i < n; i++)
+            while(!q.try_push(i))
+                std::this_thread::yield();
+    });
+
+    unsigned long expected = 0, value = 0;
+    while(expected < n) {
+        if(q.try_pop(value)) {
+            check(value == expected, "ordine FIFO spsc");
+            expected++;
+        }
+        else
+            std::this_thread::yield();
+    }
+    producer.join();
+    report(name, n, start);
+}
+
+static void bench_spsc() {
+    const unsigned long n = 2000000;
+    const unsigned int capacities[] = {64, 1024, 65536};
+    for(unsigned int c : capacities) {
+        locked_cbuffer<unsigned long> locked(c);
+        run_spsc("spsc mutex+cbuffer cap=" + std::to_string(c), locked, n);
+        spsc_cbuffer<unsigned long> spsc(c);
+        run_spsc("spsc spsc_cbuffer cap=" + std::to_string(c), spsc, n);
+    }
+}
+
+/**
+ * @brief Trasferimento con più produttori e consumatori
+ *
+ * Ogni produttore inserisce n valori; i consumatori li estraggono finché non
+ * sono stati consumati tutti. La somma dei valori estratti verifica che nessun
+ * elemento vada perso o duplicato.
+**/
+template <typename Q>
+static void run_mpmc(const std::string &name, Q &q, unsigned int producers,
+                     unsigned int consumers, unsigned long n) {
+    const unsigned long total = n * producers;
+    std::atomic<unsigned long> consumed(0), sum(0);
+    std::vector<std::thread> threads;
+
+    bench_clock::time_point start = start_timer();
+    for(unsigned int p = 0; p < producers; p++)
+        threads.push_back(std::thread([&q, n]() {
+            for(unsigned long i = 1; i <= n; i++)
+                while(!q.try_push(i))
+                    std::this_thread::yield();
+        }));
+    for(unsigned int c = 0; c < consumers; c++)
+        threads.push_back(std::thread([&q, &consumed, &sum, total]() {
+            unsigned long value, local = 0;
+            while(consumed.load(std::memory_order_relaxed) < total) {
+                if(q.try_pop(value)) {
+                    local += value;
+                    consumed.fetch_add(1, std::memory_order_relaxed);
+                }
+                else
+                    std::this_thread::yield();
+            }
+            sum.fetch_add(local);
+        }));
+    for(std::thread &t : threads)
+        t.join();
+    report(name, total, start);
+    check(sum.load() == producers * (n * (n + 1) / 2), "somma elementi mpmc");
+}
+
+static void bench_mpmc() {
+    const unsigned long n = 500000;
+    unsigned int max_threads = std::thread::hardware_concurrency();
+    if(max_threads < 2)
+        max_threads = 2;
+    for(unsigned int t = 1; t <= max_threads; t *= 2) {
+        const std::string suffix = " p=" + std::to_string(t) + " c=" + std::to_string(t);
+        locked_cbuffer<unsigned long> locked(1024);
+        run_mpmc("mpmc mutex+cbuffer" + suffix, locked, t, t, n);
+        mpmc_cbuffer<unsigned long> mpmc(1024);
+        run_mpmc("mpmc mpmc_cbuffer" + suffix, mpmc, t, t, n);
+    }
+
+    //Capacità minima: almeno due slot, il secondo inserimento non sovrascrive il primo
+    mpmc_cbuffer<unsigned long> one(1);
+    unsigned long v = 0;
+    check(one.capacity() == 2 && one.try_push(1) && one.try_push(2) && !one.try_push(3), "capacità minima mpmc");
+    check(one.try_pop(v) && v == 1 && one.try_pop(v) && v == 2 && !one.try_pop(v), "ordine mpmc");
+    bool rejected = false;
+    try {
+        mpmc_cbuffer<unsigned long> huge(0x80000001u);
+    }
+    catch(const std::length_error &) {
+        rejected = true;
+    }
+    check(rejected, "capacità eccessiva mpmc");
+}
+
+/**
+ * @brief Anello di riferimento con modulo
+ *
+ * Riproduce l'aritmetica degli indici del cbuffer originale (un modulo per
+ * ogni accesso) come termine di confronto per l'indicizzazione senza divisioni.
+**/
+template <typename T>
+struct modulo_ring {
+    T *buffer;
+    unsigned int capacity, head, size;
+
+    explicit modulo_ring(unsigned int c) : buffer(new T[c]), capacity(c), head(0), size(0) {}
+    ~modulo_ring() { delete[] buffer; }
+
+    void insert(const T &value) {
+        buffer[(head + size) % capacity] = value;
+        if(size == capacity)
+            head = (head + 1) % capacity;
+        else
+            size++;
+    }
+
+    T &operator[](unsigned int i) { return buffer[(i + head) % capacity]; }
+};
+
+/**
+ * @brief Inserimenti e letture indicizzate in un ciclo stretto
+ *
+ * Riempie il buffer più volte (sovrascrivendo) e poi ne somma gli elementi per indice.
+**/
+template <typename B>
+static void run_indexing(const std::string &name, B &b, unsigned int capacity, unsigned long rounds) {
+    bench_clock::time_point start = start_timer();
+    for(unsigned long r = 0; r < rounds; r++)
+        for(unsigned int i = 0; i < capacity + capacity / 2; i++)
+            b.insert((int)i);
+    report(name + " insert", rounds * (capacity + capacity / 2), start);
+
+    long sum = 0;
+    start = start_timer();
+    for(unsigned long r = 0; r < rounds; r++)
+        for(unsigned int i = 0; i < capacity; i++)
+            sum += b[i];
+    report(name + " index", rounds * capacity, start);
+    check(sum != 0, "somma indicizzata");
+}
+
+static void bench_indexing() {
+    const unsigned long rounds = 2000;
+    modulo_ring<int> m(1000);
+    run_indexing("modulo cap=1000", m, 1000, rounds);
+    cbuffer<int> d(1000);
+    run_indexing("cbuffer<int> cap=1000", d, 1000, rounds);
+    cbuffer<int, 1000> f;
+    run_indexing("cbuffer<int, 1000>", f, 1000, rounds);
+
+    modulo_ring<int> m2(1024);
+    run_indexing("modulo cap=1024", m2, 1024, rounds);
+    cbuffer<int> d2(1024);
+    run_indexing("cbuffer<int> cap=1024", d2, 1024, rounds);
+    cbuffer<int, 1024> f2;
+    run_indexing("cbuffer<int, 1024>", f2, 1024, rounds);
+}
+
+/**
+ * @brief Andata e ritorno di person attraverso il buffer
+ *
+ * Confronta il percorso per copia (insert(const T&), operator[], remove) con quello
+ * per spostamento (insert(T&&), pop). I nomi sono più lunghi del buffer interno
+ * di std::string, quindi ogni copia di una stringa alloca.
+**/
+static void bench_roundtrip() {
+    const unsigned long n = 200000;
+    const std::string name = "Amuro Namikawa Ray Junior", surname = "Federazione Terrestre Ray";
+    cbuffer<person> cb(64);
+
+    bench_clock::time_point start = start_timer();
+    for(unsigned long i = 0; i < n; i++) {
+        person p(name, surname);
+        cb.insert(p);
+        person out = cb[0];
+        cb.remove();
+        check(out.surname.size() == surname.size(), "person copiata");
+    }
+    report("person copy round trip", n, start);
+
+    start = start_timer();
+    for(unsigned long i = 0; i < n; i++) {
+        person p(name, surname);
+        cb.insert(std::move(p));
+        person out = cb.pop();
+        check(out.surname.size() == surname.size(), "person spostata");
+    }
+    report("person move round trip", n, start);
+}
+
+/**
+ * @brief Iterazione sull'intero buffer
+ *
+ * Confronta la somma tramite iteratori con quella segmentata sui due blocchi contigui,
+ * e misura std::sort sugli iteratori ad accesso casuale.
+**/
+static void bench_iteration() {
+    const unsigned int capacity = 100000;
+    const unsigned long rounds = 200;
+    cbuffer<int> cb(capacity);
+    for(unsigned int i = 0; i < capacity + capacity / 3; i++)
+        cb.insert((int)(i * 2654435761u % 1000));
+
+    long a = 0, b = 0;
+    bench_clock::time_point start = start_timer();
+    for(unsigned long r = 0; r < rounds; r++)
+        a += std::accumulate(cb.begin(), cb.end(), 0L);
+    report("iterator std::accumulate", rounds * capacity, start);
+
+    start = start_timer();
+    for(unsigned long r = 0; r < rounds; r++)
+        b += accumulate(cb, 0L);
+    report("segmented accumulate", rounds * capacity, start);
+    check(a == b, "somme uguali");
+
+    start = start_timer();
+    std::sort(cb.begin(), cb.end());
+    report("std::sort", capacity, start);
+    check(std::is_sorted(cb.begin(), cb.end()), "buffer ordinato");
+}
+
+/**
+ * @brief Scansione indicizzata controllata e non controllata
+ *
+ * Confronta la somma per indice con at(), che verifica l'indice e può lanciare
+ * std::out_of_range come il vecchio operator[], e con operator[] non controllato.
+**/
+static void bench_access() {
+    const unsigned int capacity = 4096;
+    const unsigned long rounds = 20000;
+    cbuffer<int> cb(capacity);
+    for(unsigned int i = 0; i < capacity + 100; i++)
+        cb.insert((int)i);
+
+    long a = 0, b = 0;
+    bench_clock::time_point start = start_timer();
+    for(unsigned long r = 0; r < rounds; r++)
+        for(unsigned int i = 0; i < cb.size(); i++)
+            a += cb.at(i);
+    report("scan at()", rounds * capacity, start);
+
+    start = start_timer();
+    for(unsigned long r = 0; r < rounds; r++)
+        for(unsigned int i = 0; i < cb.size(); i++)
+            b += cb[i];
+    report("scan operator[]", rounds * capacity, start);
+    check(a == b, "somme uguali");
+}
+
+/**
+ * @brief Consumo di un flusso di byte
+ *
+ * Un flusso di blocchi da 1500 byte attraversa un buffer da 64 KiB. Con cbuffer<char>
+ * il consumatore copia ogni blocco in un array temporaneo prima di elaborarlo; con
+ * mirrored_cbuffer<char> lo elabora direttamente tramite data(), anche a cavallo del bordo.
+**/
+static void bench_mirrored() {
+    const unsigned int block = 1500;
+    const unsigned long blocks = 200000;
+    char packet[block], tmp[block];
+    for(unsigned int i = 0; i < block; i++)
+        packet[i] = (char)i;
+
+    unsigned long a = 0, b = 0;
+    cbuffer<char> cb(65536);
+    bench_clock::time_point start = start_timer();
+    for(unsigned long i = 0; i < blocks; i++) {
+        cb.write(packet, block);
+        cb.read(tmp, block);
+        for(unsigned int j = 0; j < block; j++)
+            a += (unsigned char)tmp[j];
+    }
+    report("cbuffer<char> write+read+scan", blocks * block, start);
+
+    mirrored_cbuffer<char> mb(65536);
+    start = start_timer();
+    for(unsigned long i = 0; i < blocks; i++) {
+        mb.write(packet, block);
+        const char *p = mb.data();
+        for(unsigned int j = 0; j < block; j++)
+            b += (unsigned char)p[j];
+        mb.remove(block);
+    }
+    report("mirrored_cbuffer<char> write+scan in place", blocks * block, start);
+    check(a == b, "checksum uguali");
+}
+
+/**
+ * @brief Buffer persistente: throughput e riapertura dopo un crash
+ *
+ * Misura gli inserimenti nel file mappato rispetto al cbuffer in memoria. Poi un processo
+ * figlio inserisce numeri consecutivi finché non viene ucciso con SIGKILL: il padre riapre
+ * il file e verifica che il contenuto sia una sequenza consecutiva senza elementi corrotti.
+**/
+static void bench_persistent() {
+    const unsigned long n = 5000000;
+    const unsigned int capacity = 1 << 16;
+    const std::string path = "/tmp/cbuffer_bench_" + std::to_string(getpid()) + ".ring";
+    unlink(path.c_str());
+
+    cbuffer<unsigned long> mem(capacity);
+    bench_clock::time_point start = start_timer();
+    for(unsigned long i = 0; i < n; i++)
+        mem.insert(i);
+    report("cbuffer insert", n, start);
+    {
+        persistent_cbuffer<unsigned long> file(path, capacity);
+        start = start_timer();
+        for(unsigned long i = 0; i < n; i++)
+            file.insert(i);
+        report("persistent_cbuffer insert", n, start);
+        check(file.size() == capacity && file[0] == n - capacity, "contenuto dopo gli inserimenti");
+    }
+
+    const pid_t child = fork();
+    check(child >= 0, "fork");
+    if(child == 0) {
+        persistent_cbuffer<unsigned long> file(path, capacity);
+        for(unsigned long i = file[file.size() - 1] + 1;; i++)
+            file.insert(i);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    kill(child, SIGKILL);
+    waitpid(child, 0, 0);
+
+    start = start_timer();
+    persistent_cbuffer<unsigned long> reopened(path, capacity);
+    report("persistent_cbuffer reopen", 1, start);
+    check(reopened.size() == capacity, "dimensione dopo il crash");
+    for(unsigned int i = 1; i < reopened.size(); i++)
+        check(reopened[i] == reopened[i - 1] + 1, "sequenza consecutiva dopo il crash");
+    std::cout << "  ultimo elemento dopo il crash: " << reopened[reopened.size() - 1] << std::endl;
+
+    //Un file con un'altra capacità viene rifiutato senza essere ridimensionato
+    struct stat before, after;
+    check(stat(path.c_str(), &before) == 0, "stat");
+    bool rejected = false;
+    try {
+        persistent_cbuffer<unsigned long> larger(path, 2 * capacity);
+    }
+    catch(const std::runtime_error &) {
+        rejected = true;
+    }
+    check(rejected && stat(path.c_str(), &after) == 0 && after.st_size == before.st_size, "capacità diversa");
+
+    //Testa e dimensione corrotte vengono rifiutate alla riapertura (state segue magic e 4 campi a 32 bit)
+    const int fd = open(path.c_str(), O_RDWR);
+    const std::uint64_t corrupt = ~std::uint64_t(0);
+    check(fd >= 0 && pwrite(fd, &corrupt, sizeof(corrupt), 24) == ssize_t(sizeof(corrupt)), "pwrite");
+    close(fd);
+    rejected = false;
+    try {
+        persistent_cbuffer<unsigned long> corrupted(path, capacity);
+    }
+    catch(const std::runtime_error &) {
+        rejected = true;
+    }
+    check(rejected, "stato corrotto");
+    unlink(path.c_str());
+}
+
+/**
+ * Record di telemetria scambiato tra i processi.
+**/
+struct telemetry {
+    unsigned long seq;
+    double values[7];
+};
+
+/**
+ * @brief Latenza tra processi: memoria condivisa e pipe
+ *
+ * Il processo padre invia un record, il figlio lo rimanda indietro; si misura il tempo
+ * di andata e ritorno. Il figlio si collega ai segmenti per nome, come farebbe un processo
+ * indipendente, e il padre verifica che ogni record torni con il numero di sequenza giusto.
+**/
+static void bench_shm() {
+    const unsigned long n = 100000;
+    const std::string ping = "/cbuffer_bench_ping_" + std::to_string(getpid());
+    const std::string pong = "/cbuffer_bench_pong_" + std::to_string(getpid());
+    telemetry t = telemetry();
+
+    {
+        shm_cbuffer<telemetry> out(ping, 64), in(pong, 64);
+        const pid_t child = fork();
+        check(child >= 0, "fork");
+        if(child == 0) {
+            shm_cbuffer<telemetry> rx(ping), tx(pong);
+            telemetry r;
+            for(unsigned long i = 0; i < n; i++) {
+                while(!rx.try_pop(r))
+                    std::this_thread::yield();
+                while(!tx.try_push(r))
+                    std::this_thread::yield();
+            }
+            _exit(0);
+        }
+        bench_clock::time_point start = start_timer();
+        for(unsigned long i = 0; i < n; i++) {
+            t.seq = i;
+            while(!out.try_push(t))
+                std::this_thread::yield();
+            while(!in.try_pop(t))
+                std::this_thread::yield();
+            check(t.seq == i, "sequenza shm");
+        }
+        report("shm_cbuffer round trip", n, start);
+        waitpid(child, 0, 0);
+    }
+    shm_cbuffer<telemetry>::unlink(ping);
+    shm_cbuffer<telemetry>::unlink(pong);
+
+    int down[2], up[2];
+    check(pipe(down) == 0 && pipe(up) == 0, "pipe");
+    const pid_t child = fork();
+    check(child >= 0, "fork");
+    if(child == 0) {
+        telemetry r;
+        for(unsigned long i = 0; i < n; i++)
+            if(read(down[0], &r, sizeof(r)) != sizeof(r) || write(up[1], &r, sizeof(r)) != sizeof(r))
+                _exit(1);
+        _exit(0);
+    }
+    bench_clock::time_point start = start_timer();
+    for(unsigned long i = 0; i < n; i++) {
+        t.seq = i;
+        check(write(down[1], &t, sizeof(t)) == sizeof(t), "write pipe");
+        check(read(up[0], &t, sizeof(t)) == sizeof(t) && t.seq == i, "sequenza pipe");
+    }
+    report("pipe round trip", n, start);
+    waitpid(child, 0, 0);
+    close(down[0]); close(down[1]); close(up[0]); close(up[1]);
+}
+
+/**
+ * @brief Accessi casuali in un buffer molto grande
+ *
+ * Confronta la memoria di std::allocator con quella di hugepage_resource (pagine da 2 MiB
+ * sul nodo NUMA corrente) su letture a indici casuali, dominate dai TLB miss.
+ * La dimensione in MiB si sceglie con la variabile d'ambiente CBUFFER_BENCH_MB (default 512).
+**/
+template <typename B>
+static void run_random_access(const std::string &name, B &cb, unsigned long reads) {
+    const unsigned int capacity = cb.capacity();
+    for(unsigned int i = 0; i < capacity; i++)
+        cb.insert(i);
+
+    unsigned long x = 88172645463325252UL, sum = 0;
+    bench_clock::time_point start = start_timer();
+    for(unsigned long i = 0; i < reads; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        sum += cb[(unsigned int)(x % capacity)];
+    }
+    report(name, reads, start);
+    check(sum != 0, "somma accessi casuali");
+}
+
+static void bench_hugepage() {
+    const char *env = std::getenv("CBUFFER_BENCH_MB");
+    const unsigned long mb = env ? std::strtoul(env, 0, 10) : 512;
+    const unsigned int capacity = (unsigned int)(mb * 1024 * 1024 / sizeof(unsigned long));
+    const unsigned long reads = 20000000;
+    {
+        cbuffer<unsigned long> cb(capacity);
+        run_random_access("random read std::allocator " + std::to_string(mb) + " MiB", cb, reads);
+    }
+    {
+        hugepage_resource huge(hugepage_resource::current_node());
+        pmr::cbuffer<unsigned long> cb(capacity, &huge);
+        run_random_access("random read hugepage_resource " + std::to_string(mb) + " MiB", cb, reads);
+    }
+}
+
+/**
+ * @brief Produttore e consumatore con attese bloccanti
+ *
+ * Con full_policy::block nessun elemento va perso e i thread dormono invece di girare a vuoto;
+ * con full_policy::reject il produttore non attende e i contatori riportano gli scarti.
+**/
+static void bench_blocking() {
+    const unsigned long n = 1000000;
+    const full_policy policies[] = {full_policy::block, full_policy::reject, full_policy::overwrite};
+    const char *names[] = {"block", "reject", "overwrite"};
+    for(unsigned int p = 0; p < 3; p++) {
+        blocking_cbuffer<unsigned long> q(1024, policies[p]);
+        unsigned long received = 0;
+        bench_clock::time_point start = start_timer();
+        std::thread consumer([&q, &received]() {
+            unsigned long value;
+            while(q.pop_for(value, std::chrono::milliseconds(20)))
+                received++;
+        });
+        for(unsigned long i = 0; i < n; i++)
+            q.push(i);
+        consumer.join();
+        report(std::string("blocking_cbuffer ") + names[p], n, start);
+        std::cout << "  ricevuti " << received << ", scartati " << q.dropped()
+                  << ", sovrascritti " << q.overwritten() << std::endl;
+        check(received + q.dropped() + q.overwritten() == n, "contatori coerenti");
+    }
+}
+
+/**
+ * @brief Riallocazione e linearizzazione sul posto
+ *
+ * Confronta linearize() con la copia in un nuovo buffer e verifica l'ordine degli elementi
+ * dopo reserve, resize_capacity e shrink_to_fit, anche con un tipo non banale (person).
+**/
+static void bench_resize() {
+    const unsigned int capacity = 1000000;
+    const unsigned long rounds = 50;
+    cbuffer<int> cb(capacity);
+    for(unsigned int i = 0; i < capacity; i++)
+        cb.insert((int)i);
+
+    unsigned long shift = 0;
+    bench_clock::time_point start = start_timer();
+    for(unsigned long r = 0; r < rounds; r++) {
+        for(unsigned int i = 0; i < capacity / 3; i++)
+            cb.insert(cb.back() + 1);
+        shift += capacity / 3;
+        const int *p = cb.linearize();
+        check(p[0] == (int)shift && p[capacity - 1] == (int)(shift + capacity - 1), "linearize pieno");
+    }
+    report("linearize (pieno)", rounds * capacity, start);
+
+    start = start_timer();
+    for(unsigned long r = 0; r < rounds; r++) {
+        cbuffer<int> copy(capacity);
+        copy.insert_range(cb.begin(), cb.end());
+        check(copy.front() == cb.front(), "copia");
+    }
+    report("copia in un nuovo buffer", rounds * capacity, start);
+
+    cb.resize_capacity(capacity / 2);
+    check(cb.size() == capacity / 2 && cb.front() == (int)(shift + capacity / 2), "resize_capacity");
+    cb.reserve(capacity);
+    for(unsigned int i = 0; i < capacity / 4; i++)
+        cb.remove();
+    cb.shrink_to_fit();
+    check(cb.capacity() == capacity / 4 && cb.back() == (int)(shift + capacity - 1), "shrink_to_fit");
+
+    cbuffer<person> people(7);
+    for(unsigned int i = 0; i < 12; i++)
+        people.insert(person(std::to_string(i), "x"));
+    people.remove();
+    people.remove();
+    const person *p = people.linearize();
+    for(unsigned int i = 0; i < people.size(); i++)
+        check(p[i].name == std::to_string(7 + i), "linearize person");
+    people.reserve(20);
+    check(people.size() == 5 && people[4].name == "11", "reserve person");
+}
+
+/**
+ * @brief Operazione associativa non invertibile per window_aggregate
+**/
+struct gcd_op {
+    unsigned int operator()(unsigned int a, unsigned int b) const {
+        while(b != 0) {
+            const unsigned int r = a % b;
+            a = b;
+            b = r;
+        }
+        return a;
+    }
+};
+
+/**
+ * @brief Statistiche su finestra scorrevole
+ *
+ * Confronta il ricalcolo di somma, minimo, massimo e varianza scandendo tutta la finestra
+ * dopo ogni inserimento con l'aggiornamento incrementale di window_stats, e verifica che
+ * i risultati coincidano; misura anche window_aggregate con il massimo comun divisore.
+**/
+static void bench_window() {
+    const unsigned int sizes[] = {1000, 10000, 100000, 1000000};
+    for(unsigned int w : sizes) {
+        const unsigned long samples = 4 * (unsigned long)w;
+        const unsigned long scans = 100000000UL / w;
+        window_stats<int> stats(w);
+        cbuffer<int> scan(w);
+        unsigned int x = 12345;
+        for(unsigned long i = 0; i < samples; i++) {
+            x = x * 1103515245u + 12345u;
+            const int v = (int)(x >> 16) % 2001 - 1000;
+            stats.insert(v);
+            scan.insert(v);
+        }
+
+        bench_clock::time_point start = start_timer();
+        long long sum = 0;
+        int lo = 0, hi = 0;
+        double var = 0;
+        for(unsigned long i = 0; i < scans; i++) {
+            x = x * 1103515245u + 12345u;
+            scan.insert((int)(x >> 16) % 2001 - 1000);
+            sum = accumulate(scan, 0LL);
+            const double mean = double(sum) / w;
+            lo = hi = scan[0];
+            var = 0;
+            for_each(scan, [&lo, &hi, &var, mean](int v) {
+                lo = std::min(lo, v);
+                hi = std::max(hi, v);
+                var += (v - mean) * (v - mean);
+            });
+            var /= w;
+        }
+        report("window scan w=" + std::to_string(w), scans, start);
+
+        //Le statistiche incrementali sugli stessi campioni coincidono con la scansione
+        window_stats<int> ref(w);
+        for_each(scan, [&ref](int v) { ref.insert(v); });
+        check(ref.sum() == sum && ref.min() == lo && ref.max() == hi, "somma, minimo e massimo");
+        check(std::abs(ref.variance() - var) < 1e-6 * (var + 1), "varianza");
+
+        const unsigned long inserts = 10000000;
+        long long probe = 0;
+        start = start_timer();
+        for(unsigned long i = 0; i < inserts; i++) {
+            x = x * 1103515245u + 12345u;
+            stats.insert((int)(x >> 16) % 2001 - 1000);
+            probe += stats.max() - stats.min();
+        }
+        report("window_stats w=" + std::to_string(w), inserts, start);
+        check(probe >= 0, "minimo non superiore al massimo");
+
+        window_aggregate<unsigned int, gcd_op> g(w);
+        start = start_timer();
+        for(unsigned long i = 0; i < inserts; i++) {
+            x = x * 1103515245u + 12345u;
+            g.insert(((x >> 16) % 64 + 1) * 6);
+            probe += g.value();
+        }
+        report("window_aggregate gcd w=" + std::to_string(w), inserts, start);
+        unsigned int expected = 0;
+        for_each(g.window(), [&expected](unsigned int v) { expected = gcd_op()(expected, v); });
+        check(g.value() == expected && probe > 0, "gcd della finestra");
+    }
+}
+
+/**
+ * @brief Ciclo di evaluate_if originale
+ *
+ * Riferimento: buffer passato per valore (copia completa) e accesso per indice controllato.
+**/
+template <typename P>
+static unsigned int count_by_copy(cbuffer<int> cb, P pred) {
+    unsigned int n = 0;
+    for(unsigned int i = 0; i < cb.size(); i++)
+        if(pred(cb.at(i)))
+            n++;
+    return n;
+}
+
+/**
+ * @brief Valutazione di predicati sugli elementi
+ *
+ * Confronta il ciclo di evaluate_if con count_if ed evaluate_mask di cbuffer_algo.h,
+ * con un predicato generico (ciclo scalare) e con threshold (SIMD), verificando che
+ * conteggi, ricerche e maschere coincidano con gli algoritmi standard.
+**/
+static void bench_predicates() {
+    const unsigned int capacity = 1000000;
+    const unsigned long rounds = 100;
+    cbuffer<int> cb(capacity);
+    unsigned int x = 1;
+    for(unsigned int i = 0; i < capacity + capacity / 3; i++) {
+        x = x * 1103515245u + 12345u;
+        cb.insert((int)(x >> 8) % 1000 - 500);
+    }
+    const threshold<int, cmp_op::ge> positive = {0};
+    const auto lambda = [](int v) { return v >= 0; };
+    const unsigned int expected = std::count_if(cb.begin(), cb.end(), lambda);
+
+    unsigned int n = 0;
+    bench_clock::time_point start = start_timer();
+    for(unsigned long r = 0; r < rounds / 10; r++)
+        n = count_by_copy(cb, lambda);
+    report("copia + at()", rounds / 10 * capacity, start);
+    check(n == expected, "conteggio per copia");
+
+    start = start_timer();
+    for(unsigned long r = 0; r < rounds; r++)
+        n = count_if(cb, lambda);
+    report("count_if scalare", rounds * capacity, start);
+    check(n == expected, "conteggio scalare");
+
+    start = start_timer();
+    for(unsigned long r = 0; r < rounds; r++)
+        n = count_if(cb, positive);
+    report("count_if threshold (SIMD)", rounds * capacity, start);
+    check(n == expected, "conteggio SIMD");
+
+    std::vector<std::uint64_t> mask;
+    start = start_timer();
+    for(unsigned long r = 0; r < rounds; r++)
+        mask = evaluate_mask(cb, positive);
+    report("evaluate_mask threshold (SIMD)", rounds * capacity, start);
+    const std::vector<std::uint64_t> scalar_mask = evaluate_mask(cb, lambda);
+    check(mask == scalar_mask, "maschere uguali");
+    for(unsigned int i = 0; i < cb.size(); i += 997)
+        check(((mask[i / 64] >> (i % 64)) & 1) == (cb[i] >= 0 ? 1u : 0u), "bit della maschera");
+
+    const threshold<int, cmp_op::eq> big = {499};
+    const unsigned int first = std::find(cb.begin(), cb.end(), 499) - cb.begin();
+    check(find_if(cb, big) == first, "find_if");
+    check(any_of(cb, big) && !all_of(cb, positive) && all_of(cb, threshold<int, cmp_op::gt>{-501}),
+          "any_of e all_of");
+    check(none_of(cb, threshold<int, cmp_op::gt>{499}), "none_of");
+
+    cbuffer<float> f(1000);
+    for(unsigned int i = 0; i < 1500; i++)
+        f.insert(float(i % 7) - 3.0f);
+    check(count_if(f, threshold<float, cmp_op::lt>{0.0f}) ==
+          (unsigned int)std::count_if(f.begin(), f.end(), [](float v) { return v < 0.0f; }), "count_if float");
+}
+
+/**
+ * @brief Scalabilità degli algoritmi paralleli
+ *
+ * Misura parallel_reduce, parallel_count_if, parallel_for_each e parallel_transform su un
+ * buffer che gira, con pool da 1 thread fino al numero di processori, e verifica i risultati
+ * con le versioni sequenziali.
+**/
+static void bench_parallel() {
+    const unsigned int capacity = 1 << 24;
+    const unsigned long rounds = 10;
+    cbuffer<int> cb(capacity);
+    for(unsigned int i = 0; i < capacity + capacity / 3; i++)
+        cb.insert((int)(i % 2001) - 1000);
+    const long expected_sum = accumulate(cb, 0L);
+    const unsigned int expected_count = count_if(cb, threshold<int, cmp_op::ge>{0});
+    std::vector<long> out(capacity);
+
+    unsigned int max_threads = std::thread::hardware_concurrency();
+    if(max_threads < 1)
+        max_threads = 1;
+    for(unsigned int t = 1; ; t = (t * 2 < max_threads) ? t * 2 : max_threads) {
+        cbuffer_thread_pool pool(t);
+        const std::string suffix = " threads=" + std::to_string(t);
+
+        long sum = 0;
+        bench_clock::time_point start = start_timer();
+        for(unsigned long r = 0; r < rounds; r++)
+            sum = parallel_reduce(pool, cb, 0L, std::plus<long>());
+        report("parallel_reduce" + suffix, rounds * capacity, start);
+        check(sum == expected_sum, "parallel_reduce");
+
+        unsigned int n = 0;
+        start = start_timer();
+        for(unsigned long r = 0; r < rounds; r++)
+            n = parallel_count_if(pool, cb, threshold<int, cmp_op::ge>{0});
+        report("parallel_count_if" + suffix, rounds * capacity, start);
+        check(n == expected_count, "parallel_count_if");
+
+        start = start_timer();
+        for(unsigned long r = 0; r < rounds; r++)
+            parallel_for_each(pool, cb, [](int &v) { v = -v; });
+        report("parallel_for_each" + suffix, rounds * capacity, start);
+        check(accumulate(cb, 0L) == expected_sum, "parallel_for_each");
+
+        start = start_timer();
+        for(unsigned long r = 0; r < rounds; r++)
+            parallel_transform(pool, cb, out.begin(), [](int v) { return 3L * v; });
+        report("parallel_transform" + suffix, rounds * capacity, start);
+        check(out[0] == 3L * cb[0] && out[capacity - 1] == 3L * cb[capacity - 1] &&
+              std::accumulate(out.begin(), out.end(), 0L) == 3 * expected_sum, "parallel_transform");
+
+        if(t == max_threads)
+            break;
+    }
+}
+
+/**
+ * @brief Struttura POD di grandi dimensioni (256 byte)
+**/
+struct large_pod {
+    unsigned long seq;
+    char payload[248];
+};
+
+//Valori di prova e chiave numerica usata per le verifiche
+static void make_value(int &v, unsigned int i) { v = (int)i; }
+static void make_value(person &v, unsigned int i) { v = person("Amuro" + std::to_string(i % 100), "Ray"); }
+static void make_value(large_pod &v, unsigned int i) { v.seq = i; std::memset(v.payload, (int)i, sizeof(v.payload)); }
+static unsigned long key(const int &v) { return (unsigned long)v; }
+static unsigned long key(const person &v) { return v.name.size(); }
+static unsigned long key(const large_pod &v) { return v.seq; }
+
+/**
+ * @brief Adattatori dei contenitori confrontati
+ *
+ * Stessa interfaccia per cbuffer, std::deque e un anello su std::vector:
+ * push sovrascrive il più vecchio se il contenitore è pieno, pop rimuove il più vecchio.
+**/
+template <typename T>
+struct cbuffer_adapter {
+    static const char *name() { return "cbuffer"; }
+    cbuffer<T> c;
+    explicit cbuffer_adapter(unsigned int capacity) : c(capacity) {}
+    void push(const T &v) { c.insert(v); }
+    void pop() { c.remove(); }
+    void clear() { c.clear(); }
+    const T &operator[](unsigned int i) const { return c[i]; }
+    unsigned int size() const { return c.size(); }
+    template <typename F> void iterate(F f) const { for_each(c, f); }
+};
+
+template <typename T>
+struct deque_adapter {
+    static const char *name() { return "std::deque"; }
+    std::deque<T> d;
+    unsigned int capacity;
+    explicit deque_adapter(unsigned int c) : capacity(c) {}
+    void push(const T &v) {
+        if(d.size() == capacity)
+            d.pop_front();
+        d.push_back(v);
+    }
+    void pop() { d.pop_front(); }
+    void clear() { d.clear(); }
+    const T &operator[](unsigned int i) const { return d[i]; }
+    unsigned int size() const { return (unsigned int)d.size(); }
+    template <typename F> void iterate(F f) const { for(const T &v : d) f(v); }
+};
+
+template <typename T>
+struct vector_ring {
+    static const char *name() { return "vector ring"; }
+    std::vector<T> v;
+    unsigned int head, count;
+    explicit vector_ring(unsigned int c) : v(c), head(0), count(0) {}
+    unsigned int wrap(unsigned int i) const { return (i >= v.size()) ? i - (unsigned int)v.size() : i; }
+    void push(const T &x) {
+        v[wrap(head + count)] = x;
+        if(count == v.size())
+            head = wrap(head + 1);
+        else
+            count++;
+    }
+    void pop() { head = wrap(head + 1); count--; }
+    void clear() { head = count = 0; }
+    const T &operator[](unsigned int i) const { return v[wrap(head + i)]; }
+    unsigned int size() const { return count; }
+    template <typename F> void iterate(F f) const {
+        for(unsigned int i = 0; i < count; i++)
+            f((*this)[i]);
+    }
+};
+
+/**
+ * @brief Misure di un contenitore con un tipo e una capacità
+ *
+ * insert: riempimento da vuoto; overwrite: inserimenti a contenitore pieno; pop: lettura e
+ * rimozione del più vecchio fino allo svuotamento;
+ * access: lettura per indice; iteration: visita completa; copy: copia dell'intero contenitore.
+ * @return La somma delle chiavi visitate, per il confronto tra contenitori
+**/
+template <template <typename> class C, typename T>
+static unsigned long run_container(const char *type, unsigned int capacity, unsigned long target) {
+    std::vector<T> values(capacity);
+    for(unsigned int i = 0; i < capacity; i++)
+        make_value(values[i], i);
+    const unsigned long rounds = (target + capacity - 1) / capacity;
+    const unsigned long ops = rounds * capacity;
+    //Nomi costruiti prima delle misure, per non contarne le allocazioni
+    const std::string prefix = std::string(C<T>::name()) + " " + type + " cap=" + std::to_string(capacity) + " ";
+    const std::string insert = prefix + "insert", overwrite = prefix + "overwrite", access = prefix + "access",
+                      iteration = prefix + "iteration", copy = prefix + "copy", pop = prefix + "pop";
+    C<T> c(capacity);
+
+    //Inserimenti da vuoto: si misurano solo i riempimenti, non gli svuotamenti
+    double ns = 0;
+    unsigned long allocs = 0;
+    bench_clock::time_point start;
+    for(unsigned long r = 0; r < rounds; r++) {
+        c.clear();
+        start = start_timer();
+        for(unsigned int i = 0; i < capacity; i++)
+            c.push(values[i]);
+        ns += elapsed_ns(start);
+        allocs += allocations.load() - alloc_mark;
+    }
+    alloc_mark = allocations.load() - allocs;
+    report_ns(insert, ops, ns);
+
+    start = start_timer();
+    for(unsigned long r = 0; r < rounds; r++)
+        for(unsigned int i = 0; i < capacity; i++)
+            c.push(values[(i + r) % capacity]);
+    report(overwrite, ops, start);
+
+    unsigned long sum = 0;
+    start = start_timer();
+    for(unsigned long r = 0; r < rounds; r++)
+        for(unsigned int i = 0; i < capacity; i++)
+            sum += key(c[i]);
+    report(access, ops, start);
+
+    start = start_timer();
+    for(unsigned long r = 0; r < rounds; r++)
+        c.iterate([&sum](const T &v) { sum += key(v); });
+    report(iteration, ops, start);
+
+    start = start_timer();
+    for(unsigned long r = 0; r < rounds; r++) {
+        const C<T> other(c);
+        sum += key(other[(unsigned int)(r % capacity)]);
+    }
+    report(copy, ops, start);
+
+    ns = 0;
+    allocs = 0;
+    for(unsigned long r = 0; r < rounds; r++) {
+        c.clear();
+        for(unsigned int i = 0; i < capacity; i++)
+            c.push(values[i]);
+        start = start_timer();
+        for(unsigned int i = 0; i < capacity; i++) {
+            sum += key(c[0]);
+            c.pop();
+        }
+        ns += elapsed_ns(start);
+        allocs += allocations.load() - alloc_mark;
+    }
+    alloc_mark = allocations.load() - allocs;
+    report_ns(pop, ops, ns);
+    return sum;
+}
+
+/**
+ * @brief Confronto di un tipo su tutti i contenitori e le capacità
+**/
+template <typename T>
+static void run_containers(const char *type, unsigned long target) {
+    const unsigned int capacities[] = {64, 4096, 262144};
+    for(unsigned int capacity : capacities) {
+        const unsigned long a = run_container<cbuffer_adapter, T>(type, capacity, target);
+        const unsigned long b = run_container<deque_adapter, T>(type, capacity, target);
+        const unsigned long c = run_container<vector_ring, T>(type, capacity, target);
+        check(a == b && b == c, "stesso contenuto nei tre contenitori");
+    }
+}
+
+/**
+ * @brief Record di un sensore per il confronto righe/colonne
+**/
+struct reading {
+    int sensor;
+    float value;
+    double time;
+};
+
+/**
+ * @brief Scansione di un campo: righe contro colonne
+ *
+ * Conta le person con cognome "Ray" e le letture oltre una soglia in un cbuffer di record
+ * e in un soa_cbuffer, che legge solo la colonna interessata (vettoriale per float),
+ * e verifica che conteggi e stampa delle righe coincidano.
+**/
+static void bench_soa() {
+    const unsigned int capacity = 1 << 20;
+    const unsigned long rounds = 20;
+    const auto srn_ray = [](const std::string &s) { return s == "Ray"; };
+
+    cbuffer<person> rows(capacity);
+    soa_cbuffer<person, &person::name, &person::surname> cols(capacity);
+    for(unsigned int i = 0; i < capacity + capacity / 3; i++) {
+        const person p("Amuro" + std::to_string(i % 100), (i % 3 == 0) ? "Ray" : "Aznable");
+        rows.insert(p);
+        cols.insert(p);
+    }
+    const unsigned int expected = std::count_if(rows.begin(), rows.end(),
+                                                [&](const person &p) { return srn_ray(p.surname); });
+
+    unsigned int n = 0;
+    bench_clock::time_point start = start_timer();
+    for(unsigned long r = 0; r < rounds; r++)
+        n = count_if(rows, [&](const person &p) { return srn_ray(p.surname); });
+    report("person: count_if cognome (righe)", rounds * capacity, start);
+    check(n == expected, "conteggio person righe");
+
+    start = start_timer();
+    for(unsigned long r = 0; r < rounds; r++)
+        n = cols.count_if<1>(srn_ray);
+    report("person: count_if cognome (colonne)", rounds * capacity, start);
+    check(n == expected, "conteggio person colonne");
+
+    std::ostringstream a, b;
+    a << rows[0] << rows[capacity - 1];
+    b << cols[0] << cols[capacity - 1];
+    check(a.str() == b.str(), "stampa della riga");
+    const person back = cols.back();
+    check(back.name == rows.back().name && cols.find_if<1>(srn_ray) == (unsigned int)(std::find_if(
+          rows.begin(), rows.end(), [&](const person &p) { return srn_ray(p.surname); }) - rows.begin()), "find_if");
+
+    cbuffer<reading> readings(capacity);
+    soa_cbuffer<reading, &reading::sensor, &reading::value, &reading::time> columns(capacity);
+    for(unsigned int i = 0; i < capacity + capacity / 3; i++) {
+        const reading v = {(int)(i % 64), float(i % 1000) / 1000.0f, i * 0.001};
+        readings.insert(v);
+        columns.insert(v);
+    }
+    const auto over = [](const reading &v) { return v.value > 0.75f; };
+    const unsigned int readings_over = std::count_if(readings.begin(), readings.end(), over);
+
+    start = start_timer();
+    for(unsigned long r = 0; r < rounds * 5; r++)
+        n = count_if(readings, over);
+    report("reading: count_if valore (righe)", rounds * 5 * capacity, start);
+    check(n == readings_over, "conteggio reading righe");
+
+    start = start_timer();
+    for(unsigned long r = 0; r < rounds * 5; r++)
+        n = columns.count_if<1>(threshold<float, cmp_op::gt>{0.75f});
+    report("reading: count_if valore (colonne, SIMD)", rounds * 5 * capacity, start);
+    check(n == readings_over, "conteggio reading colonne");
+
+    const soa_cbuffer<reading, &reading::sensor, &reading::value, &reading::time>::const_column_range<2>
+        one = columns.column_one<2>(), two = columns.column_two<2>();
+    check(one.second + two.second == capacity && *one.first == readings.front().time, "colonne");
+}
+
+/**
+ * @brief Record di lunghezza variabile: area di byte contro cbuffer<person>
+ *
+ * Registra person con nomi oltre la small string optimization in un cbuffer<person>
+ * e in un record_cbuffer con lo stesso numero medio di record, e ne rilegge i campi.
+ * Verifica il contenuto, l'ordine e il budget di byte contro una std::deque di riferimento.
+**/
+static void bench_records() {
+    const unsigned int capacity = 65536;
+    const unsigned long n = 4000000;
+    std::vector<person> people;
+    for(unsigned int i = 0; i < 1000; i++)
+        people.push_back(person("Amuro Ray numero " + std::to_string(i) + std::string(i % 23, 'x'),
+                                "Federazione Terrestre " + std::to_string(i % 7)));
+
+    cbuffer<person> rows(capacity);
+    unsigned long bytes = 0;
+    bench_clock::time_point start = start_timer();
+    for(unsigned long i = 0; i < n; i++) {
+        rows.insert(people[i % people.size()]);
+        bytes += rows.back().name.size();
+    }
+    report("cbuffer<person> insert", n, start);
+
+    std::size_t average = 0;
+    for(const person &p : people)
+        average += record_cbuffer::record_bytes({p.name, p.surname});
+    record_cbuffer records(static_cast<unsigned int>(average / people.size() * capacity));
+    unsigned long record_bytes = 0;
+    start = start_timer();
+    for(unsigned long i = 0; i < n; i++) {
+        const person &p = people[i % people.size()];
+        records.insert({p.name, p.surname});
+        record_bytes += p.name.size();
+    }
+    report("record_cbuffer insert", n, start);
+    check(bytes == record_bytes && records.used() <= records.budget(), "inserimenti");
+
+    start = start_timer();
+    bytes = 0;
+    for(unsigned long r = 0; r < n / capacity; r++)
+        for(const person &p : rows)
+            bytes += p.surname.size();
+    report("cbuffer<person> lettura", n / capacity * rows.size(), start);
+
+    start = start_timer();
+    record_bytes = 0;
+    for(unsigned long r = 0; r < n / capacity; r++)
+        for(record_view v : records)
+            record_bytes += v[1].size();
+    report("record_cbuffer lettura", n / capacity * records.size(), start);
+    check(bytes != 0 && record_bytes != 0, "letture");
+
+    //Confronto con un modello: eviction per budget, padding di fine area e ordine dei record
+    record_cbuffer small(1000);
+    std::deque<std::pair<std::string, std::string> > model;
+    std::size_t model_bytes = 0;
+    unsigned int x = 7;
+    for(unsigned int i = 0; i < 200000; i++) {
+        x = x * 1103515245u + 12345u;
+        if(i % 50000 == 49999)
+            small.set_budget(small.capacity() / (i / 50000 + 2));
+        if((x >> 16) % 4 == 0 && model.size() != 0) {
+            small.remove();
+            model_bytes -= record_cbuffer::record_bytes({model.front().first, model.front().second});
+            model.pop_front();
+        }
+        else {
+            const std::pair<std::string, std::string> r(std::string((x >> 8) % 61, 'a' + i % 26),
+                                                        std::to_string(i));
+            const std::size_t b = record_cbuffer::record_bytes({r.first, r.second});
+            small.insert({r.first, r.second});
+            model.push_back(r);
+            model_bytes += b;
+            while(model_bytes > small.budget() || model.size() > small.size()) {
+                model_bytes -= record_cbuffer::record_bytes({model.front().first, model.front().second});
+                model.pop_front();
+            }
+        }
+        check(small.size() <= model.size() && small.used() <= small.budget(), "budget");
+        while(model.size() > small.size()) {
+            model_bytes -= record_cbuffer::record_bytes({model.front().first, model.front().second});
+            model.pop_front();
+        }
+        std::size_t k = 0;
+        for(record_view v : small) {
+            check(v.fields() == 2 && v[0] == model[k].first && v[1] == model[k].second, "contenuto");
+            k++;
+        }
+        check(k == model.size(), "numero di record");
+    }
+}
+
+/**
+ * @brief Coroutine avviata subito e distrutta con l'oggetto
+**/
+struct bench_task {
+    struct promise_type {
+        bench_task get_return_object() {
+            return bench_task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+
+    explicit bench_task(std::coroutine_handle<promise_type> h) : handle(h) {}
+    bench_task(const bench_task &) = delete;
+    ~bench_task() { handle.destroy(); }
+
+    bool done() const { return handle.done(); }
+};
+
+static std::uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(bench_clock::now().time_since_epoch()).count();
+}
+
+//Consumatore a coroutine: riceve blocchi di al più batch timestamp e ne somma la latenza
+static bench_task consume(async_cbuffer<std::uint64_t> &ring, unsigned long n, unsigned int batch,
+                          double &latency, unsigned long &received) {
+    while(received < n) {
+        const std::vector<std::uint64_t> v = co_await ring.pop_n(batch);
+        const std::uint64_t now = now_ns();
+        for(std::uint64_t t : v)
+            latency += double(now - t);
+        received += v.size();
+    }
+}
+
+//Consumatore che verifica l'ordine degli elementi ricevuti con pop()
+static bench_task consume_in_order(async_cbuffer<std::uint64_t> &ring, unsigned long n, unsigned long &received) {
+    while(received < n) {
+        const std::uint64_t v = co_await ring.pop();
+        check(v == received, "ordine di pop");
+        received++;
+    }
+}
+
+//Produttore a raffiche: burst timestamp ogni pause
+static void produce(async_cbuffer<std::uint64_t> &ring, unsigned long n, unsigned int burst,
+                    std::chrono::microseconds pause) {
+    for(unsigned long i = 0; i < n; i += burst) {
+        for(unsigned int j = 0; j < burst && i + j < n; j++)
+            ring.insert(now_ns());
+        std::this_thread::sleep_for(pause);
+    }
+}
+
+/**
+ * @brief Latenza dei consumatori: polling contro coroutine su eventfd
+ *
+ * Un produttore inserisce raffiche di timestamp; il consumatore li estrae controllando
+ * size() a intervalli fissi oppure come coroutine ripresa da un event loop epoll sul
+ * readable_fd(). Il tempo per operazione riportato è la latenza media di consegna.
+ * Verifica anche l'ordine con pop() e la notifica unica per una raffica di insert.
+**/
+static void bench_async() {
+    const unsigned long n = 20000;
+    const unsigned int burst = 8;
+    const std::chrono::microseconds pause(50);
+
+    const unsigned int intervals[] = {100, 1000};
+    for(unsigned int us : intervals) {
+        async_cbuffer<std::uint64_t> ring(4096);
+        std::thread producer(produce, std::ref(ring), n, burst, pause);
+        double latency = 0;
+        unsigned long received = 0, wakeups = 0;
+        std::uint64_t t;
+        while(received < n) {
+            std::this_thread::sleep_for(std::chrono::microseconds(us));
+            wakeups++;
+            while(ring.try_pop(t)) {
+                latency += double(now_ns() - t);
+                received++;
+            }
+        }
+        producer.join();
+        report_ns("latenza polling " + std::to_string(us) + "us", n, latency);
+        std::cout << "  risvegli: " << wakeups << std::endl;
+    }
+
+    {
+        async_cbuffer<std::uint64_t> ring(4096, resume_mode::eventfd);
+        const int ep = epoll_create1(EPOLL_CLOEXEC);
+        check(ep >= 0, "epoll_create1");
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = ring.readable_fd();
+        check(epoll_ctl(ep, EPOLL_CTL_ADD, ring.readable_fd(), &ev) == 0, "epoll_ctl");
+
+        double latency = 0;
+        unsigned long received = 0, wakeups = 0;
+        bench_task consumer = consume(ring, n, 64, latency, received);
+        std::thread producer(produce, std::ref(ring), n, burst, pause);
+        while(!consumer.done()) {
+            epoll_event ready;
+            if(epoll_wait(ep, &ready, 1, -1) == 1) {
+                wakeups++;
+                ring.resume_waiters();
+            }
+        }
+        producer.join();
+        close(ep);
+        report_ns("latenza co_await pop_n + eventfd", n, latency);
+        std::cout << "  risvegli: " << wakeups << ", notifiche: " << ring.notifications() << std::endl;
+    }
+
+    //Ripresa nel thread del produttore
+    async_cbuffer<std::uint64_t> direct(16);
+    unsigned long received = 0;
+    bench_task in_order = consume_in_order(direct, 1000, received);
+    for(std::uint64_t i = 0; i < 1000; i++) {
+        direct.insert(i);
+        check(received == i + 1, "ripresa inline");
+    }
+    check(in_order.done(), "fine del consumatore");
+
+    //Una raffica produce una sola notifica e viene consegnata in un solo blocco
+    async_cbuffer<std::uint64_t> burst_ring(2048, resume_mode::eventfd);
+    double latency = 0;
+    received = 0;
+    bench_task batch = consume(burst_ring, 1000, 2000, latency, received);
+    for(unsigned int i = 0; i < 1000; i++)
+        burst_ring.insert(now_ns());
+    check(burst_ring.notifications() == 1, "notifica unica");
+    check(burst_ring.resume_waiters() == 1 && received == 1000 && batch.done(), "blocco unico");
+    check(burst_ring.notifications() == 2 && burst_ring.size() == 0, "azzeramento");
+
+    //Elementi che nessuna coroutine attende non tengono readable_fd() leggibile
+    async_cbuffer<std::uint64_t> idle(16, resume_mode::eventfd);
+    pollfd pfd = {idle.readable_fd(), POLLIN, 0};
+    received = 0;
+    bench_task one = consume_in_order(idle, 1, received);
+    for(std::uint64_t i = 0; i < 3; i++)
+        idle.insert(i);
+    check(poll(&pfd, 1, 0) == 1, "descrittore leggibile con consumatore in attesa");
+    check(idle.resume_waiters() == 1 && one.done() && idle.size() == 2, "consumatore ripreso");
+    check(poll(&pfd, 1, 0) == 0, "descrittore azzerato senza consumatori");
+    received = 1;
+    bench_task two = consume_in_order(idle, 3, received);
+    check(two.done() && idle.size() == 0 && poll(&pfd, 1, 0) == 0, "consegna senza sospensione");
+}
+
+/**
+ * @brief Elemento con numero di sequenza ripetuto, per riconoscere le letture strappate
+**/
+struct stamped {
+    std::uint64_t seq[8];
+};
+
+//Lettore di broadcast_cbuffer: verifica continuità delle sequenze e integrità degli elementi
+static void broadcast_reader(broadcast_cbuffer<stamped>::reader r, std::uint64_t n, std::uint64_t &lost) {
+    std::vector<stamped> batch(256);
+    std::uint64_t next = r.cursor();
+    lost = 0;
+    while(next < n) {
+        const broadcast_cbuffer<stamped>::read_result res = r.read(batch.data(), 256);
+        check(res.first == next + res.lost, "continuità delle sequenze");
+        for(unsigned int i = 0; i < res.count; i++)
+            for(unsigned int k = 0; k < 8; k++)
+                check(batch[i].seq[k] == res.first + i, "elemento integro");
+        lost += res.lost;
+        next = res.first + res.count;
+        if(res.count == 0)
+            std::this_thread::yield();
+    }
+}
+
+/**
+ * @brief Un produttore, più consumatori che vedono tutti gli elementi
+ *
+ * Confronta la copia di ogni elemento in un cbuffer per consumatore con un unico
+ * broadcast_cbuffer letto da consumatori indipendenti, al crescere dei consumatori.
+ * Verifica poi con thread reali che ogni lettore riceva sequenze continue ed elementi
+ * integri, e che un lettore doppiato conti esattamente gli elementi persi.
+**/
+static void bench_broadcast() {
+    const unsigned int capacity = 4096, batch = 256;
+    const unsigned long n = 4000000;
+    std::vector<int> in(batch), out(batch);
+    const unsigned int consumers[] = {1, 2, 4, 8};
+    for(unsigned int k : consumers) {
+        std::vector<cbuffer<int> > copies(k, cbuffer<int>(capacity));
+        long sum = 0;
+        bench_clock::time_point start = start_timer();
+        for(unsigned long i = 0; i < n; i += batch) {
+            for(unsigned int j = 0; j < batch; j++)
+                in[j] = (int)(i + j);
+            for(cbuffer<int> &c : copies)
+                c.write(in.data(), batch);
+            for(cbuffer<int> &c : copies) {
+                c.read(out.data(), batch);
+                sum += out[batch - 1];
+            }
+        }
+        report("copia per consumatore, consumatori=" + std::to_string(k), n, start);
+        std::cout << "  memoria: " << k * capacity * sizeof(int) << " byte" << std::endl;
+
+        broadcast_cbuffer<int> ring(capacity);
+        std::vector<broadcast_cbuffer<int>::reader> readers(k, ring.subscribe());
+        long broadcast_sum = 0;
+        start = start_timer();
+        for(unsigned long i = 0; i < n; i += batch) {
+            for(unsigned int j = 0; j < batch; j++)
+                in[j] = (int)(i + j);
+            ring.insert(in.data(), batch);
+            for(broadcast_cbuffer<int>::reader &r : readers) {
+                r.read(out.data(), batch);
+                broadcast_sum += out[batch - 1];
+            }
+        }
+        report("broadcast, consumatori=" + std::to_string(k), n, start);
+        std::cout << "  memoria: " << 2 * ring.capacity() * sizeof(int) << " byte" << std::endl;
+        check(sum == broadcast_sum, "stessi elementi");
+    }
+
+    //Lettore doppiato
+    broadcast_cbuffer<int> ring(1024);
+    broadcast_cbuffer<int>::reader slow = ring.subscribe();
+    for(int i = 0; i < 3000; i++)
+        ring.insert(i);
+    check(slow.lapped(), "lettore doppiato");
+    std::vector<int> all(1024);
+    const broadcast_cbuffer<int>::read_result res = slow.read(all.data(), 1024);
+    check(res.lost == 3000 - 1024 && res.count == 1024 && all[0] == 3000 - 1024 && !slow.lapped(), "elementi persi");
+
+    //Scrittore e lettori concorrenti
+    const std::uint64_t m = 2000000;
+    broadcast_cbuffer<stamped> shared(1024);
+    std::uint64_t lost[2];
+    //Lettori registrati prima di avviare lo scrittore: i cursori partono dalla sequenza 0
+    std::thread r0(broadcast_reader, shared.subscribe(true), m, std::ref(lost[0]));
+    std::thread r1(broadcast_reader, shared.subscribe(true), m, std::ref(lost[1]));
+    bench_clock::time_point start = start_timer();
+    stamped s;
+    for(std::uint64_t i = 0; i < m; i++) {
+        for(unsigned int k = 0; k < 8; k++)
+            s.seq[k] = i;
+        shared.insert(s);
+    }
+    report("scrittore con 2 lettori concorrenti", m, start);
+    r0.join();
+    r1.join();
+    std::cout << "  persi: " << lost[0] << ", " << lost[1] << std::endl;
+
+    //Scrittore che cede il processore ogni 4096 inserimenti: i lettori vengono doppiati
+    //mentre lo scrittore è attivo e devono comunque completare le copie
+    broadcast_cbuffer<stamped> paced(1024);
+    std::thread p0(broadcast_reader, paced.subscribe(true), m, std::ref(lost[0]));
+    std::thread p1(broadcast_reader, paced.subscribe(true), m, std::ref(lost[1]));
+    start = start_timer();
+    for(std::uint64_t i = 0; i < m; i++) {
+        for(unsigned int k = 0; k < 8; k++)
+            s.seq[k] = i;
+        paced.insert(s);
+        if(i % 4096 == 4095)
+            std::this_thread::yield();
+    }
+    report("scrittore con pause e 2 lettori concorrenti", m, start);
+    p0.join();
+    p1.join();
+    std::cout << "  persi: " << lost[0] << ", " << lost[1] << std::endl;
+}
+
+//Fotografie continue di un broadcast_cbuffer finché stop non diventa true
+//(max == capacità: overload di default); le fotografie fallite non vengono contate
+static void snapshotter(const broadcast_cbuffer<stamped> &ring, unsigned int max, const std::atomic<bool> &stop,
+                        unsigned long &snapshots, unsigned long &retries, unsigned long &failures) {
+    std::vector<stamped> out;
+    snapshots = retries = failures = 0;
+    while(!stop.load(std::memory_order_relaxed)) {
+        const broadcast_cbuffer<stamped>::snapshot_result r =
+            (max == ring.capacity()) ? ring.snapshot(out) : ring.snapshot(out, max);
+        retries += r.retries;
+        if(!r.complete) {
+            check(r.count == 0 && out.empty(), "fotografia fallita");
+            failures++;
+            continue;
+        }
+        check(r.count == out.size() && r.first + r.count <= ring.sequence(), "dimensione della fotografia");
+        for(unsigned int i = 0; i < r.count; i++)
+            for(unsigned int k = 0; k < 8; k++)
+                check(out[i].seq[k] == r.first + i, "fotografia non strappata");
+        snapshots++;
+    }
+}
+
+/**
+ * @brief Fotografie coerenti con scrittore attivo
+ *
+ * Misura il throughput dello scrittore di un broadcast_cbuffer da solo e con un thread
+ * che fotografa continuamente il contenuto con snapshot(), verificando che ogni fotografia
+ * contenga solo elementi integri e sequenze consecutive (mai una copia strappata).
+**/
+static void bench_snapshot() {
+    const unsigned int capacity = 4096;
+    const std::uint64_t n = 20000000;
+    stamped s;
+
+    broadcast_cbuffer<stamped> alone(capacity);
+    bench_clock::time_point start = start_timer();
+    for(std::uint64_t i = 0; i < n; i++) {
+        for(unsigned int k = 0; k < 8; k++)
+            s.seq[k] = i;
+        alone.insert(s);
+    }
+    report("scrittore senza fotografie", n, start);
+
+    const unsigned int sizes[] = {capacity / 2, capacity - capacity / 8, capacity};
+    for(unsigned int max : sizes) {
+        broadcast_cbuffer<stamped> ring(capacity);
+        std::atomic<bool> stop(false);
+        unsigned long snapshots = 0, retries = 0, failures = 0;
+        std::thread t(snapshotter, std::cref(ring), max, std::cref(stop), std::ref(snapshots), std::ref(retries),
+                      std::ref(failures));
+        start = start_timer();
+        for(std::uint64_t i = 0; i < n; i++) {
+            for(unsigned int k = 0; k < 8; k++)
+                s.seq[k] = i;
+            ring.insert(s);
+        }
+        report("scrittore con fotografie di " + std::to_string(max), n, start);
+        stop.store(true);
+        t.join();
+        std::cout << "  fotografie: " << snapshots << ", ripetizioni: " << retries
+                  << ", fallite: " << failures << std::endl;
+        check(snapshots != 0, "fotografie completate");
+    }
+
+    //A scrittore fermo la fotografia è l'intero contenuto, senza ripetizioni
+    std::vector<stamped> out;
+    const broadcast_cbuffer<stamped>::snapshot_result r = alone.snapshot(out);
+    check(r.complete && r.count == alone.capacity() && r.first == n - alone.capacity() && r.retries == 0 &&
+          out.back().seq[0] == n - 1, "fotografia completa");
+}
+
+/**
+ * @brief Elemento di 3 byte: i trasferimenti si fermano spesso a metà elemento
+**/
+struct triple {
+    unsigned char c[3];
+};
+
+//Consumatore di una pipe non bloccante: legge triple con read_from_fd e ne verifica l'ordine
+static void triple_reader(int fd, unsigned int n, unsigned int &received, unsigned long &partials) {
+    cbuffer<triple> dst(1000);
+    cbuffer<triple>::fd_partial partial;
+    received = 0;
+    partials = 0;
+    triple t;
+    for(;;) {
+        const std::ptrdiff_t r = dst.read_from_fd(fd, 1000, partial);
+        if(r == 0)
+            break;
+        partials += partial.pending();
+        if(r < 0) {
+            pollfd pfd = {fd, POLLIN, 0};
+            poll(&pfd, 1, -1);
+        }
+        while(dst.try_pop(t)) {
+            check(t.c[0] == (received & 255) && t.c[1] == ((received >> 8) & 255) &&
+                  t.c[2] == ((received >> 16) & 255), "ordine delle triple");
+            received++;
+        }
+    }
+    check(received == n && !partial.pending(), "triple ricevute");
+}
+
+/**
+ * @brief Trasferimento tra cbuffer e descrittori
+ *
+ * Rilancia il contenuto di un cbuffer<char> attraverso una pipe e di nuovo nel buffer,
+ * copiando con operator[] in un buffer temporaneo oppure con write_to_fd e read_from_fd
+ * (writev e readv direttamente sui blocchi del buffer), e verifica che il contenuto non cambi.
+ * Verifica poi con una pipe non bloccante alle due estremità che gli elementi di 3 byte,
+ * spesso trasferiti a metà, arrivino interi e in ordine senza che le chiamate attendano.
+**/
+static void bench_fdio() {
+    const unsigned int capacity = 65536, chunk = 32768;
+    const unsigned long rounds = 20000;
+    cbuffer<char> cb(capacity);
+    for(unsigned int i = 0; i < capacity + capacity / 3; i++)
+        cb.insert((char)(i % 251));
+    const cbuffer<char> expected(cb);
+    int fds[2];
+    check(pipe(fds) == 0, "pipe");
+    cbuffer<char>::fd_partial in, out;
+
+    std::vector<char> tmp(chunk);
+    bench_clock::time_point start = start_timer();
+    for(unsigned long r = 0; r < rounds; r++) {
+        for(unsigned int i = 0; i < chunk; i++)
+            tmp[i] = cb[i];
+        check(::write(fds[1], tmp.data(), chunk) == (ssize_t)chunk, "write");
+        for(unsigned int i = 0; i < chunk; i++)
+            cb.remove();
+        const ssize_t got = ::read(fds[0], tmp.data(), chunk);
+        check(got == (ssize_t)chunk, "read");
+        cb.write(tmp.data(), chunk);
+    }
+    report("relay operator[] + write/read (byte)", rounds * chunk, start);
+    check(std::equal(cb.begin(), cb.end(), expected.begin()), "contenuto dopo il relay con copia");
+
+    start = start_timer();
+    for(unsigned long r = 0; r < rounds; r++) {
+        check(cb.write_to_fd(fds[1], chunk, out) == chunk, "write_to_fd");
+        check(cb.read_from_fd(fds[0], chunk, in) == chunk, "read_from_fd");
+    }
+    report("relay write_to_fd/read_from_fd (byte)", rounds * chunk, start);
+    check(cb.size() == capacity && std::equal(cb.begin(), cb.end(), expected.begin()), "contenuto dopo il relay");
+    close(fds[0]);
+    close(fds[1]);
+
+    const unsigned int n = 100000;
+    cbuffer<triple> src(n);
+    for(unsigned int i = 0; i < n; i++) {
+        const triple t = {{(unsigned char)i, (unsigned char)(i >> 8), (unsigned char)(i >> 16)}};
+        src.insert(t);
+    }
+    check(pipe(fds) == 0, "pipe");
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+    cbuffer<triple>::fd_partial sent;
+    unsigned int received = 0;
+    unsigned long read_partials = 0, write_partials = 0;
+    std::thread reader(triple_reader, fds[0], n, std::ref(received), std::ref(read_partials));
+    while(src.size() != 0 || sent.pending()) {
+        const std::ptrdiff_t w = src.write_to_fd(fds[1], 50000, sent);
+        write_partials += sent.pending();
+        if(w < 0) {
+            pollfd pfd = {fds[1], POLLOUT, 0};
+            poll(&pfd, 1, -1);
+        }
+    }
+    close(fds[1]);
+    reader.join();
+    close(fds[0]);
+    std::cout << "  elementi a metà: " << write_partials << " in scrittura, " << read_partials
+              << " in lettura" << std::endl;
+    //Lettura a metà elemento su pipe non bloccante: nessuna attesa, completamento alla chiamata successiva
+    check(pipe(fds) == 0, "pipe");
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    cbuffer<triple> dst(4);
+    cbuffer<triple>::fd_partial partial;
+    const unsigned char bytes[] = {1, 2, 3, 4, 5, 6};
+    check(::write(fds[1], bytes, 5) == 5, "write");
+    check(dst.read_from_fd(fds[0], 4, partial) == 1 && partial.pending() && partial.done == 2, "elemento a metà");
+    check(dst.read_from_fd(fds[0], 4, partial) == -1 && errno == EAGAIN && dst.size() == 1, "lettura non bloccante");
+    check(::write(fds[1], bytes + 5, 1) == 1, "write");
+    check(dst.read_from_fd(fds[0], 4, partial) == 1 && !partial.pending() && dst.size() == 2 &&
+          dst[1].c[0] == 4 && dst[1].c[2] == 6, "elemento completato");
+    check(::write(fds[1], bytes, 1) == 1, "write");
+    close(fds[1]);
+    bool truncated = false;
+    try {
+        dst.read_from_fd(fds[0], 4, partial);
+        dst.read_from_fd(fds[0], 4, partial);
+    }
+    catch(const std::runtime_error &) {
+        truncated = true;
+    }
+    check(truncated && dst.size() == 2, "elemento troncato");
+    close(fds[0]);
+}
+
+/**
+ * @brief Costo della strumentazione
+ *
+ * Inserimenti e rimozioni alternati con il livello CBUFFER_STATS di questa compilazione:
+ * confrontando bench.exe con bench_stats.exe (make bench-stats, livello 2) si ottiene il
+ * costo dei contatori. Con la strumentazione attiva verifica anche i contatori.
+**/
+static void bench_stats() {
+    const unsigned int capacity = 1024;
+    const unsigned long n = 20000000;
+    const std::string level = " (CBUFFER_STATS=" + std::to_string(CBUFFER_STATS) + ")";
+    cbuffer<int> cb(capacity);
+    unsigned long sum = 0;
+
+    bench_clock::time_point start = start_timer();
+    for(unsigned long i = 0; i < n; i++) {
+        cb.insert((int)i);
+        if(i % 4 != 3) {
+            sum += cb.front();
+            cb.remove();
+        }
+    }
+    report("insert/remove" + level, n, start);
+    check(sum != 0, "somma");
+
+    //Il livello fa parte del tipo: un buffer strumentato convive con quelli di default
+    cbuffer<int, 0, std::allocator<int>, 1> counted(4);
+    for(int i = 0; i < 6; i++)
+        counted.insert(i);
+    check(counted.stats().inserts == 6 && counted.stats().overwrites == 2, "livello come parametro");
+
+    const cbuffer_stats s = cb.stats();
+    if(CBUFFER_STATS == 0) {
+        check(s.inserts == 0 && s.removes == 0, "contatori disattivati");
+        return;
+    }
+    const unsigned long removes = n - n / 4;
+    const unsigned long overwrites = n - removes - capacity;
+    check(s.inserts == n && s.removes == removes, "inserimenti e rimozioni");
+    check(s.overwrites == overwrites && s.high_watermark == capacity, "sovrascritture");
+    unsigned long samples = 0;
+    for(unsigned int b = 0; b < cbuffer_stats::buckets; b++)
+        samples += s.occupancy[b];
+    check(samples == n && s.occupancy[cbuffer_stats::buckets - 1] != 0, "istogramma");
+    std::cout << "inserimenti " << s.inserts << ", rimozioni " << s.removes
+              << ", sovrascritture " << s.overwrites << ", massimo " << s.high_watermark << std::endl;
+    if(CBUFFER_STATS == 2) {
+        check(s.residency_samples != 0 && s.residency_max_ns >= s.residency_mean_ns(), "latenza");
+        std::cout << "permanenza media " << s.residency_mean_ns() << " ns, massima "
+                  << s.residency_max_ns << " ns su " << s.residency_samples << " campioni" << std::endl;
+    }
+
+    cbuffer<int> moved(std::move(cb));
+    check(moved.stats().inserts == n && cb.stats().inserts == 0, "statistiche spostate");
+    moved.reset_stats();
+    check(moved.stats().inserts == 0, "reset_stats");
+}
+
+/**
+ * @brief cbuffer contro std::deque e anello su std::vector
+**/
+static void bench_containers() {
+    run_containers<int>("int", 4000000);
+    run_containers<person>("person", 500000);
+    run_containers<large_pod>("large_pod", 500000);
+}
+
+struct bench_entry {
+    const char *name;
+    void (*run)();
+};
+
+static const bench_entry benches[] = {
+    {"spsc", bench_spsc},
+    {"mpmc", bench_mpmc},
+    {"indexing", bench_indexing},
+    {"roundtrip", bench_roundtrip},
+    {"iteration", bench_iteration},
+    {"access", bench_access},
+    {"mirrored", bench_mirrored},
+    {"persistent", bench_persistent},
+    {"shm", bench_shm},
+    {"hugepage", bench_hugepage},
+    {"blocking", bench_blocking},
+    {"resize", bench_resize},
+    {"window", bench_window},
+    {"predicates", bench_predicates},
+    {"parallel", bench_parallel},
+    {"containers", bench_containers},
+    {"stats", bench_stats},
+    {"soa", bench_soa},
+    {"records", bench_records},
+    {"async", bench_async},
+    {"broadcast", bench_broadcast},
+    {"snapshot", bench_snapshot},
+    {"fdio", bench_fdio},
+};
+
+/**
+ * @brief Scrittura dei risultati in formato CSV
+**/
+static void write_csv(const char *path) {
+    std::ofstream out(path);
+    out << "bench,name,ops,ns_per_op,ops_per_s,allocs_per_op\n";
+    for(const bench_result &r : results)
+        out << r.bench << ",\"" << r.name << "\"," << r.ops << "," << r.ns_per_op << ","
+            << r.ops_per_s << "," << r.allocs_per_op << "\n";
+    check(out.good(), "scrittura del file CSV");
+}
+
+/**
+ * @brief Scrittura dei risultati in formato JSON
+**/
+static void write_json(const char *path) {
+    std::ofstream out(path);
+    out << "[\n";
+    for(std::size_t i = 0; i < results.size(); i++) {
+        const bench_result &r = results[i];
+        out << "  {\"bench\": \"" << r.bench << "\", \"name\": \"" << r.name << "\", \"ops\": " << r.ops
+            << ", \"ns_per_op\": " << r.ns_per_op << ", \"ops_per_s\": " << r.ops_per_s
+            << ", \"allocs_per_op\": " << r.allocs_per_op << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+    check(out.good(), "scrittura del file JSON");
+}
+
+int main(int argc, char *argv[]) {
+    const char *csv = 0, *json = 0;
+    int names = 0;
+    for(int i = 1; i < argc; i++) {
+        if(std::strncmp(argv[i], "--csv=", 6) == 0)
+            csv = argv[i] + 6;
+        else if(std::strncmp(argv[i], "--json=", 7) == 0)
+            json = argv[i] + 7;
+        else
+            names++;
+    }
+
+    for(const bench_entry &b : benches) {
+        bool selected = (names == 0);
+        for(int i = 1; i < argc; i++)
+            if(std::strcmp(argv[i], b.name) == 0)
+                selected = true;
+        if(selected) {
+            std::cout << "== " << b.name << std::endl;
+            current_bench = b.name;
+            b.run();
+        }
+    }
+
+    if(csv != 0)
+        write_csv(csv);
+    if(json != 0)
+        write_json(json);
+}
@@ -0,0 +1,274 @@
+#ifndef BLOCKING_CBUFFER_H
+#define BLOCKING_CBUFFER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional> // std::function
+#include <mutex>
+#include <utility>    // std::move
+#include "cbuffer.h"
+
+/**
+ * @file blocking_cbuffer.h
+ * @brief Dichiarazione della classe blocking_cbuffer
+ *
+ * cbuffer thread-safe con politica configurabile per il buffer pieno e attese bloccanti
+ * (su condition variable, senza polling) per produttori e consumatori.
+**/
+
+/**
+ * @brief Politica di inserimento a buffer pieno
+ *
+ * overwrite: l'elemento più vecchio viene sovrascritto (comportamento di cbuffer::insert)
+ * reject:    l'inserimento fallisce e l'elemento viene scartato
+ * block:     il produttore attende che si liberi spazio
+ * evict:     come overwrite, ma l'elemento più vecchio viene passato alla callback di espulsione
+**/
+enum class full_policy {
+    overwrite,
+    reject,
+    block,
+    evict
+};
+
+template <class T>
+class blocking_cbuffer {
+    public:
+        typedef typename cbuffer<T>::size_type size_type;
+        typedef std::function<void(T&&)> evict_callback;
+
+        /**
+         * @brief Costruttore secondario
+         *
+         * @param capacity Capacità del buffer
+         * @param policy Politica a buffer pieno
+         * @param on_evict Callback chiamata con l'elemento espulso (solo con full_policy::evict),
+         *        fuori dal lock e nel thread del produttore
+        **/
+        explicit blocking_cbuffer(size_type capacity, full_policy policy = full_policy::overwrite,
+                                  evict_callback on_evict = evict_callback())
+                : _cb(capacity), _policy(policy), _on_evict(std::move(on_evict)),
+                  _dropped(0), _overwritten(0), _waiting_producers(0), _waiting_consumers(0) {
+        }
+
+        /**
+         * @brief Inserimento di un elemento
+         *
+         * Inserisce secondo la politica del buffer; con full_policy::block attende senza limite.
+         * @param value Un elemento da inserire
+         * @return false se l'elemento è stato scartato (full_policy::reject), true altrimenti
+        **/
+        bool push(const T &value) {
+            T copy(value);
+            return push_until(std::move(copy), std::chrono::steady_clock::time_point::max());
+        }
+
+        /**
+         * @brief Inserimento di un elemento per spostamento
+         *
+         * @param value Un elemento da spostare nel buffer
+         * @return false se l'elemento è stato scartato (full_policy::reject), true altrimenti
+        **/
+        bool push(T &&value) {
+            return push_until(std::move(value), std::chrono::steady_clock::time_point::max());
+        }
+
+        /**
+         * @brief Inserimento con attesa limitata
+         *
+         * Come push, ma con full_policy::block attende al massimo timeout.
+         * @param value Un elemento da spostare nel buffer
+         * @param timeout Attesa massima
+         * @return false se l'elemento è stato scartato o il tempo è scaduto
+        **/
+        template <class Rep, class Period>
+        bool push_for(T &&value, const std::chrono::duration<Rep, Period> &timeout) {
+            return push_until(std::move(value), std::chrono::steady_clock::now() + timeout);
+        }
+
+        /**
+         * @brief Estrazione bloccante
+         *
+         * Attende che il buffer contenga almeno un elemento e lo estrae.
+         * @return L'elemento che si trovava in testa al buffer
+        **/
+        T pop() {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while(_cb.size() == 0)
+                wait(_not_empty, _waiting_consumers, lock);
+            T value(_cb.pop());
+            notify_not_full();
+            return value;
+        }
+
+        /**
+         * @brief Estrazione con attesa limitata
+         *
+         * @param value Reference in cui viene spostato l'elemento estratto
+         * @param timeout Attesa massima
+         * @return true se un elemento è stato estratto, false se il tempo è scaduto
+        **/
+        template <class Rep, class Period>
+        bool pop_for(T &value, const std::chrono::duration<Rep, Period> &timeout) {
+            const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+            std::unique_lock<std::mutex> lock(_mutex);
+            while(_cb.size() == 0)
+                if(!wait_until(_not_empty, _waiting_consumers, lock, deadline) && _cb.size() == 0)
+                    return false;
+            _cb.try_pop(value);
+            notify_not_full();
+            return true;
+        }
+
+        /**
+         * @brief Estrazione non bloccante
+         *
+         * @param value Reference in cui viene spostato l'elemento estratto
+         * @return true se un elemento è stato estratto, false se il buffer è vuoto
+        **/
+        bool try_pop(T &value) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if(!_cb.try_pop(value))
+                return false;
+            notify_not_full();
+            return true;
+        }
+
+        /**
+         * @brief Dimensione del buffer
+         *
+         * @return Il numero di elementi presenti
+        **/
+        size_type size() const {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _cb.size();
+        }
+
+        /**
+         * @brief Capacità del buffer
+         *
+         * @return Il numero massimo di elementi contenuti
+        **/
+        size_type capacity() const {
+            return _cb.capacity();
+        }
+
+        /**
+         * @brief Elementi scartati
+         *
+         * @return Il numero di inserimenti rifiutati (reject) o scaduti (block con timeout)
+        **/
+        unsigned long dropped() const {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _dropped;
+        }
+
+        /**
+         * @brief Elementi sovrascritti
+         *
+         * @return Il numero di elementi persi per sovrascrittura (overwrite) o espulsi (evict)
+        **/
+        unsigned long overwritten() const {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _overwritten;
+        }
+
+    private:
+        //Non copiabile: contiene mutex e condition variable
+        blocking_cbuffer(const blocking_cbuffer &other);
+        blocking_cbuffer &operator=(const blocking_cbuffer &other);
+
+        cbuffer<T> _cb;
+        full_policy _policy;
+        evict_callback _on_evict;
+        unsigned long _dropped;
+        unsigned long _overwritten;
+
+        mutable std::mutex _mutex;
+        std::condition_variable _not_empty;
+        std::condition_variable _not_full;
+        unsigned int _waiting_producers;
+        unsigned int _waiting_consumers;
+
+        /**
+         * @brief Inserimento secondo la politica
+         *
+         * @param value Un elemento da spostare nel buffer
+         * @param deadline Istante massimo di attesa per full_policy::block
+         * @return false se l'elemento è stato scartato
+        **/
+        bool push_until(T &&value, std::chrono::steady_clock::time_point deadline) {
+            std::unique_lock<std::mutex> lock(_mutex);
+            switch(_policy) {
+                case full_policy::reject:
+                    if(!_cb.try_insert(std::move(value))) {
+                        _dropped++;
+                        return false;
+                    }
+                    break;
+                case full_policy::block:
+                    //try_insert non consuma value se il buffer è pieno
+                    while(!_cb.try_insert(std::move(value)))
+                        if(!wait_until(_not_full, _waiting_producers, lock, deadline) &&
+                           _cb.size() == _cb.capacity()) {
+                            _dropped++;
+                            return false;
+                        }
+                    break;
+                case full_policy::evict:
+                    if(_cb.size() == _cb.capacity() && _on_evict) {
+                        T evicted(_cb.pop());
+                        _cb.insert(std::move(value));
+                        _overwritten++;
+                        notify_not_empty();
+                        lock.unlock();
+                        _on_evict(std::move(evicted));
+                        return true;
+                    }
+                    [[fallthrough]];
+                case full_policy::overwrite:
+                    if(_cb.size() == _cb.capacity())
+                        _overwritten++;
+                    _cb.insert(std::move(value));
+                    break;
+            }
+            notify_not_empty();
+            return true;
+        }
+
+        /**
+         * Attesa su una condition variable tenendo il conto dei thread in attesa,
+         * così le notifiche vengono inviate solo se qualcuno sta aspettando.
+        **/
+        static void wait(std::condition_variable &cv, unsigned int &waiting, std::unique_lock<std::mutex> &lock) {
+            waiting++;
+            cv.wait(lock);
+            waiting--;
+        }
+
+        static bool wait_until(std::condition_variable &cv, unsigned int &waiting,
+                               std::unique_lock<std::mutex> &lock, std::chrono::steady_clock::time_point deadline) {
+            waiting++;
+            bool notified = true;
+            if(deadline == std::chrono::steady_clock::time_point::max())
+                cv.wait(lock);
+            else
+                notified = (cv.wait_until(lock, deadline) == std::cv_status::no_timeout);
+            waiting--;
+            return notified;
+        }
+
+        //Sveglia un consumatore, se ce n'è almeno uno in attesa
+        void notify_not_empty() {
+            if(_waiting_consumers != 0)
+                _not_empty.notify_one();
+        }
+
+        //Sveglia un produttore, se ce n'è almeno uno in attesa
+        void notify_not_full() {
+            if(_waiting_producers != 0)
+                _not_full.notify_one();
+        }
+};
+
+#endif
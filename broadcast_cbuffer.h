@@ -0,0 +1,336 @@
+#ifndef BROADCAST_CBUFFER_H
+#define BROADCAST_CBUFFER_H
+
+#include <atomic>
+#include <cstdint>     // std::uint64_t
+#include <cstring>     // std::memcpy
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @file broadcast_cbuffer.h
+ * @brief Dichiarazione della classe broadcast_cbuffer
+ *
+ * Buffer circolare con un solo scrittore e un numero qualsiasi di lettori, ciascuno dei
+ * quali vede tutti gli elementi. Ogni lettore ha il proprio cursore (numero di sequenza)
+ * sulla memoria condivisa: lo scrittore non conosce i lettori e non li attende mai, quindi
+ * memoria e costo di scrittura non dipendono dal numero di lettori. Un lettore troppo lento
+ * viene doppiato: gli elementi sovrascritti prima della lettura vengono contati come persi.
+ * Come in un seqlock, i lettori copiano gli slot senza sincronizzarsi con lo scrittore e poi
+ * verificano che nessuno di essi sia stato riscritto durante la copia, altrimenti la ripetono.
+ * La memoria contiene il doppio degli slot della capacità: gli elementi conservati sono solo gli
+ * ultimi capacity(), e gli slot di riserva permettono allo scrittore di inserire fino a
+ * capacity() elementi durante una copia senza strapparla.
+**/
+
+#ifndef CBUFFER_CACHE_LINE
+#define CBUFFER_CACHE_LINE 64
+#endif
+
+template <class T>
+class broadcast_cbuffer {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "broadcast_cbuffer richiede un tipo banalmente copiabile");
+
+    public:
+        typedef unsigned int size_type;
+        typedef std::uint64_t sequence_type;
+
+        /**
+         * @brief Risultato di una lettura
+        **/
+        struct read_result {
+            size_type count;      // elementi copiati
+            sequence_type first;  // numero di sequenza del primo elemento copiato
+            sequence_type lost;   // elementi sovrascritti prima di essere letti
+        };
+
+        /**
+         * @brief Risultato di una fotografia
+        **/
+        struct snapshot_result {
+            size_type count;       // elementi copiati
+            sequence_type first;   // numero di sequenza del primo elemento copiato
+            unsigned int retries;  // copie ripetute perché strappate dallo scrittore
+            bool complete;         // false se tutte le copie concesse sono state strappate
+        };
+
+        /**
+         * @brief Ripetizioni concesse di default a snapshot()
+        **/
+        static const unsigned int snapshot_retries = 16;
+
+        /**
+         * @brief Lettore con cursore indipendente
+         *
+         * Ogni lettore va usato da un solo thread; lettori diversi possono leggere
+         * in parallelo tra loro e con lo scrittore.
+        **/
+        class reader {
+            public:
+                /**
+                 * @brief Lettura di un blocco di elementi
+                 *
+                 * Copia in dst fino a max elementi consecutivi a partire dal cursore, in al più
+                 * due memcpy, e avanza il cursore. Se il lettore è stato doppiato il cursore salta
+                 * al più vecchio elemento conservato; la copia viene ripetuta solo se lo scrittore
+                 * inserisce più di capacity() elementi mentre è in corso.
+                 * @param dst Array di almeno max elementi
+                 * @param max Numero massimo di elementi da leggere
+                 * @return Elementi copiati, sequenza del primo, elementi persi
+                **/
+                read_result read(T *dst, size_type max) {
+                    read_result r = {0, _cursor, 0};
+                    for(;;) {
+                        const sequence_type write = _ring->_write.load(std::memory_order_acquire);
+                        const sequence_type capacity = _ring->capacity();
+                        sequence_type first = _cursor;
+                        if(write - first > capacity)
+                            first = write - capacity;
+                        const sequence_type available = write - first;
+                        const size_type n = (available < max) ? static_cast<size_type>(available) : max;
+                        _ring->copy(first, n, dst);
+                        if(_ring->intact(first)) {
+                            r.count = n;
+                            r.first = first;
+                            r.lost = first - _cursor;
+                            _cursor = first + n;
+                            return r;
+                        }
+                    }
+                }
+
+                /**
+                 * @brief Elementi da leggere
+                 *
+                 * @return Il numero di elementi scritti dopo il cursore, anche se già sovrascritti
+                **/
+                sequence_type available() const {
+                    return _ring->_write.load(std::memory_order_acquire) - _cursor;
+                }
+
+                /**
+                 * @brief Lettore doppiato
+                 *
+                 * @return true se lo scrittore ha già sovrascritto elementi non letti
+                **/
+                bool lapped() const {
+                    return available() > _ring->capacity();
+                }
+
+                /**
+                 * @brief Numero di sequenza del prossimo elemento da leggere
+                **/
+                sequence_type cursor() const {
+                    return _cursor;
+                }
+
+                /**
+                 * @brief Salto agli elementi più recenti
+                 *
+                 * Scarta gli elementi non letti e posiziona il cursore dopo l'ultimo scritto.
+                **/
+                void skip() {
+                    _cursor = _ring->_write.load(std::memory_order_acquire);
+                }
+
+            private:
+                const broadcast_cbuffer *_ring;
+                sequence_type _cursor;
+
+                friend class broadcast_cbuffer;
+
+                reader(const broadcast_cbuffer *ring, sequence_type cursor) : _ring(ring), _cursor(cursor) {
+                }
+        };
+
+        /**
+         * @brief Costruttore secondario
+         *
+         * @param capacity Numero minimo di elementi conservati, arrotondato alla potenza
+         *        di due successiva per indicizzare con una maschera; vengono allocati
+         *        2 * capacity() slot
+         * @throw std::length_error se capacity supera la più grande potenza di due rappresentabile
+         *        con gli slot di riserva
+         * @throw Eccezione di allocazione memoria
+        **/
+        explicit broadcast_cbuffer(size_type capacity) : _buffer(0), _capacity(1), _mask(0), _claim(0), _write(0) {
+            if(capacity > max_capacity)
+                throw std::length_error("broadcast_cbuffer: capacity too large");
+            while(_capacity < capacity)
+                _capacity <<= 1;
+            _buffer = new T[2 * std::size_t(_capacity)];
+            _mask = 2 * _capacity - 1;
+        }
+
+        /**
+         * @brief Distruttore
+        **/
+        ~broadcast_cbuffer() {
+            delete[] _buffer;
+            _buffer = 0;
+        }
+
+        /**
+         * @brief Inserimento di un elemento (solo scrittore)
+         *
+         * Non attende mai i lettori: se il buffer è pieno l'elemento più vecchio viene sovrascritto.
+         * @param value Un elemento da inserire
+        **/
+        void insert(const T &value) {
+            const sequence_type seq = _write.load(std::memory_order_relaxed);
+            begin_write(seq + 1);
+            _buffer[seq & _mask] = value;
+            _write.store(seq + 1, std::memory_order_release);
+        }
+
+        /**
+         * @brief Inserimento di un blocco di elementi (solo scrittore)
+         *
+         * Copia n elementi in al più due memcpy e li pubblica insieme ai lettori.
+         * Di un blocco più lungo della capacità restano solo gli ultimi capacity() elementi.
+         * @param src Puntatore al primo elemento
+         * @param n Numero di elementi
+        **/
+        void insert(const T *src, size_type n) {
+            sequence_type seq = _write.load(std::memory_order_relaxed);
+            if(n > capacity()) {
+                src += n - capacity();
+                seq += n - capacity();
+                n = capacity();
+            }
+            begin_write(seq + n);
+            const size_type pos = static_cast<size_type>(seq & _mask);
+            const size_type one = (n < slots() - pos) ? n : slots() - pos;
+            std::memcpy(static_cast<void*>(_buffer + pos), src, one * sizeof(T));
+            std::memcpy(static_cast<void*>(_buffer), src + one, (n - one) * sizeof(T));
+            _write.store(seq + n, std::memory_order_release);
+        }
+
+        /**
+         * @brief Nuovo lettore
+         *
+         * @param from_oldest true per iniziare dal più vecchio elemento conservato,
+         *        false per ricevere solo gli elementi inseriti da ora in poi
+         * @return Un lettore indipendente dagli altri
+        **/
+        reader subscribe(bool from_oldest = false) const {
+            const sequence_type write = _write.load(std::memory_order_acquire);
+            if(!from_oldest)
+                return reader(this, write);
+            return reader(this, (write > capacity()) ? write - capacity() : 0);
+        }
+
+        /**
+         * @brief Fotografia coerente degli elementi più recenti
+         *
+         * Copia in out gli ultimi min(max, capacity()) elementi pubblicati, in due blocchi,
+         * senza mai bloccare lo scrittore: se durante la copia lo scrittore ha riscritto uno
+         * degli slot copiati la copia è strappata e viene ripetuta (protocollo seqlock sui
+         * contatori dello scrittore). Al termine out contiene esattamente gli elementi con
+         * sequenza [first, first + count), come erano al momento della pubblicazione.
+         * Grazie agli slot di riserva lo scrittore può inserire almeno capacity() elementi
+         * durante la copia senza strapparla, quindi le ripetizioni sono rare anche con uno
+         * scrittore continuo. Dopo retries ripetizioni la fotografia fallisce e la funzione
+         * ritorna comunque, con complete == false e out vuoto.
+         * Può essere chiamata da più thread, in parallelo con i lettori.
+         * @param out Vettore ridimensionato al numero di elementi copiati
+         * @param max Numero massimo di elementi da copiare
+         * @param retries Numero massimo di copie ripetute
+         * @return Elementi copiati, sequenza del primo, numero di ripetizioni, esito
+        **/
+        snapshot_result snapshot(std::vector<T> &out, size_type max, unsigned int retries = snapshot_retries) const {
+            snapshot_result r = {0, 0, 0, false};
+            for(;; r.retries++) {
+                const sequence_type write = _write.load(std::memory_order_acquire);
+                const sequence_type retained = (write < max) ? write : max;
+                const size_type n = static_cast<size_type>(retained < capacity() ? retained : capacity());
+                out.resize(n);
+                copy(write - n, n, out.data());
+                if(intact(write - n)) {
+                    r.count = n;
+                    r.first = write - n;
+                    r.complete = true;
+                    return r;
+                }
+                if(r.retries == retries) {
+                    out.clear();
+                    return r;
+                }
+            }
+        }
+
+        /**
+         * @brief Fotografia coerente di tutti gli elementi conservati
+         *
+         * Come snapshot(out, capacity()), con snapshot_retries ripetizioni.
+        **/
+        snapshot_result snapshot(std::vector<T> &out) const {
+            return snapshot(out, capacity());
+        }
+
+        /**
+         * @brief Capacità del buffer
+         *
+         * @return Il numero massimo di elementi conservati (potenza di due)
+        **/
+        size_type capacity() const {
+            return _capacity;
+        }
+
+        /**
+         * @brief Numero di sequenza del prossimo elemento da scrivere
+         *
+         * @return Il numero di elementi inseriti dalla costruzione
+        **/
+        sequence_type sequence() const {
+            return _write.load(std::memory_order_acquire);
+        }
+
+    private:
+        //Non copiabile: i contatori atomici sono condivisi tra i thread
+        broadcast_cbuffer(const broadcast_cbuffer &other);
+        broadcast_cbuffer &operator=(const broadcast_cbuffer &other);
+
+        static const size_type max_capacity = (std::numeric_limits<size_type>::max() >> 2) + 1;
+
+        T *_buffer;
+        size_type _capacity;
+        size_type _mask;   // 2 * _capacity - 1
+
+        //Contatori dello scrittore: gli elementi [_write, _claim) sono in scrittura,
+        //quelli prima di _write sono pubblicati
+        alignas(CBUFFER_CACHE_LINE) std::atomic<sequence_type> _claim;
+        std::atomic<sequence_type> _write;
+
+        //Annuncia la scrittura degli elementi fino a end (escluso) prima di toccarne gli slot
+        void begin_write(sequence_type end) {
+            _claim.store(end, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        //Slot allocati, capacità più riserva
+        size_type slots() const {
+            return _mask + 1;
+        }
+
+        //Copia n elementi a partire dalla sequenza first, in al più due blocchi
+        void copy(sequence_type first, size_type n, T *dst) const {
+            const size_type pos = static_cast<size_type>(first & _mask);
+            const size_type one = (n < slots() - pos) ? n : slots() - pos;
+            std::memcpy(static_cast<void*>(dst), _buffer + pos, one * sizeof(T));
+            std::memcpy(static_cast<void*>(dst + one), _buffer, (n - one) * sizeof(T));
+        }
+
+        //Dopo una copia: true se nessuno slot dalla sequenza first in poi è stato
+        //riscritto durante la copia (lo scrittore non ha annunciato sequenze >= first + slots()).
+        //Poiché first >= write - capacity(), lo scrittore ha almeno capacity() elementi di margine
+        bool intact(sequence_type first) const {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return _claim.load(std::memory_order_relaxed) <= first + slots();
+        }
+};
+
+#endif
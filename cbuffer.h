@@ -2,24 +2,76 @@
 #define CBUFFER_H
 
 #include <ostream> // std::ostream
-#include <iostream>
 #include <cassert>
 #include <algorithm>
 #include <stdexcept>
-#include <iterator> // std::forward_iterator_tag
-#include <cstddef>  // std::ptrdiff_t
+#include <iterator> // std::random_access_iterator_tag, std::reverse_iterator
+#include <cstddef>  // std::ptrdiff_t, std::size_t
+#include <cstring>  // std::memcpy
+#include <new>      // placement new, ::operator new
+#include <memory>   // std::allocator, std::allocator_traits
+#include <memory_resource> // std::pmr::polymorphic_allocator
+#include <numeric>  // std::accumulate
+#include <functional> // std::plus
+#include <utility>  // std::forward, std::move
+#include <type_traits>
+#include "cbuffer_stats.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CBUFFER_FD_IO 1
+#include <cerrno>
+#include <system_error> // std::system_error
+#include <sys/uio.h>    // readv, writev
+#endif
 
 /**
  * @file cbuffer.h
  * @brief Dichiarazione della classe cbuffer
  * 
- * Buffer circolare di elementi generici T. La dimensione viene decisa in fase di costruzione.
+ * Buffer circolare di elementi generici T. La dimensione viene decisa in fase di costruzione
+ * (N == 0) oppure in fase di compilazione tramite il parametro N, con memoria interna all'oggetto.
+ * Con N == 0 la memoria è ottenuta dall'allocatore Alloc, secondo std::allocator_traits.
+ * Il parametro Stats sceglie il livello dei contatori di utilizzo (vedi cbuffer_stats.h).
 **/
 
+/**
+ * @brief Memoria interna di un cbuffer a capacità fissa
+ * 
+ * Spazio non inizializzato per N elementi contenuto nell'oggetto cbuffer, senza allocazioni
+ * sullo heap. Gli elementi vengono costruiti solo al momento dell'inserimento.
+**/
+template <class T, std::size_t N>
+struct cbuffer_storage {
+    alignas(T) unsigned char bytes[N * sizeof(T)];
+
+    T *data() {
+        return reinterpret_cast<T*>(bytes);
+    }
+};
+
+/**
+ * @brief Memoria interna di un cbuffer a capacità dinamica
+ * 
+ * Specializzazione vuota: lo spazio per gli elementi è allocato sullo heap dal costruttore.
+**/
 template <class T>
+struct cbuffer_storage<T, 0> {
+    T *data() {
+        return 0;
+    }
+};
+
+template <class T, std::size_t N = 0, class Alloc = std::allocator<T>, int Stats = CBUFFER_STATS>
 class cbuffer {
+        typedef std::allocator_traits<Alloc> alloc_traits;
+        static_assert(std::is_same<typename alloc_traits::pointer, T*>::value,
+                      "cbuffer richiede un allocatore con puntatori semplici");
+
     public:
         typedef unsigned int size_type;
+        typedef Alloc allocator_type;
+        typedef std::pair<T*, size_type> array_range;
+        typedef std::pair<const T*, size_type> const_array_range;
         class const_iterator;
         class iterator;
 
@@ -31,70 +83,127 @@ class cbuffer {
          * 
          * Costruttore di default che instanzia un cbuffer vuoto.
         **/
-        cbuffer() : _buffer(0), _capacity(0), _head(0), _size(0) {
-            #ifndef NDEBUG
-            std::cout << "cbuffer::cbuffer()" << std::endl;
-            #endif    
+        cbuffer() : _buffer(0), _capacity(0), _head(0), _size(0), _alloc() {
+            init_storage(0);
+        }
+
+        /**
+         * @brief Costruttore con allocatore
+         * 
+         * Instanzia un cbuffer vuoto che userà alloc per la memoria.
+         * @param alloc allocatore
+        **/
+        explicit cbuffer(const Alloc &alloc) : _buffer(0), _capacity(0), _head(0), _size(0), _alloc(alloc) {
+            init_storage(0);
         }
 
         /**
          * @brief Costruttore secondario
          * 
-         * Costruttore secondario che prende in input la dimensione del cbuffer
+         * Costruttore secondario che prende in input la dimensione del cbuffer.
+         * Disponibile solo per N == 0: con N != 0 la capacità è già fissata.
+         * @param capacity capacità del buffer
+         * @param alloc allocatore da cui ottenere la memoria
         **/
-        explicit cbuffer(size_type capacity) : _buffer(0), _capacity(0), _head(0), _size(0) {
-            _buffer = new T[capacity];
-            _capacity = capacity;
-        
-            #ifndef NDEBUG
-            std::cout << "cbuffer::cbuffer(size_type)" << std::endl;
-            #endif    
+        explicit cbuffer(size_type capacity, const Alloc &alloc = Alloc())
+                : _buffer(0), _capacity(0), _head(0), _size(0), _alloc(alloc) {
+            static_assert(N == 0, "cbuffer<T, N>: capacita' fissata in compilazione");
+            init_storage(capacity);
         }
 
         /**
          * @brief Costruttore di copia
          * 
-         * Costruttore fondamentale, instanzia un cbuffer a partire dal reference di un altro cbuffer
+         * Costruttore fondamentale, instanzia un cbuffer a partire dal reference di un altro cbuffer.
+         * Vengono copiati solo gli elementi presenti, nelle stesse posizioni fisiche.
+         * L'allocatore è ottenuto con select_on_container_copy_construction.
         **/
-        cbuffer(const cbuffer& other) : _buffer(0), _capacity(0), _head(0), _size(0) {
-            _buffer = new T[other._capacity];
-            _capacity = other._capacity;
-            _head = other._head;
-            _size = other._size;
-
-            try{
-                for(int i = 0; i < _capacity; i++)
-                    _buffer[i] = other._buffer[i];
-            }
-            catch(...){
-                delete[] _buffer;
-                _buffer = 0;
-                _capacity = 0;
-                _head = 0;
-                _size = 0;
-                throw;
-            }
+        cbuffer(const cbuffer& other) : _buffer(0), _capacity(0), _head(0), _size(0),
+                _alloc(alloc_traits::select_on_container_copy_construction(other._alloc)) {
+            init_copy(other);
+        }
 
-            #ifndef NDEBUG
-            std::cout << "cbuffer::cbuffer(const cbuffer&)" << std::endl;
-            #endif     
+        /**
+         * @brief Costruttore di copia con allocatore
+         * 
+         * Come il costruttore di copia, ma la memoria è ottenuta da alloc.
+         * @param other cbuffer da copiare
+         * @param alloc allocatore
+        **/
+        cbuffer(const cbuffer& other, const Alloc &alloc) : _buffer(0), _capacity(0), _head(0), _size(0), _alloc(alloc) {
+            init_copy(other);
         }
 
         /**
          * @brief Operatore di assegnamento
          * 
-         * Overloading dell'operatore di assegnamento tra due cbuffer
+         * Overloading dell'operatore di assegnamento tra due cbuffer.
+         * L'allocatore di other viene adottato se propagate_on_container_copy_assignment lo richiede.
         **/
         cbuffer &operator=(const cbuffer &other) {
-            if(this != other) {
-                cbuffer tmp(other);
-                this->swap(tmp);
+            if(this != &other) {
+                if constexpr(alloc_traits::propagate_on_container_copy_assignment::value) {
+                    if(_alloc != other._alloc)
+                        release_storage();
+                    _alloc = other._alloc;
+                }
+                cbuffer tmp(other, _alloc);
+                swap_storage(tmp);
             }
-            #ifndef NDEBUG
-		    std::cout << "cbuffer::operator=(const cbuffer&)" << std::endl;
-		    #endif
 
-		    return *this;
+            return *this;
+        }
+
+        /**
+         * @brief Costruttore di spostamento
+         * 
+         * Instanzia un cbuffer prendendo possesso degli elementi di other, che resta vuoto.
+         * Con N == 0 vengono trasferiti solo l'allocatore e il puntatore alla memoria, altrimenti
+         * gli elementi sono spostati uno a uno nelle stesse posizioni fisiche.
+        **/
+        cbuffer(cbuffer &&other) noexcept(N == 0 || std::is_nothrow_move_constructible<T>::value)
+                : _buffer(0), _capacity(0), _head(0), _size(0), _alloc(std::move(other._alloc)) {
+            if(N != 0) {
+                init_storage(N);
+                move_elements(other);
+            }
+            else
+                swap_storage(other);
+        }
+
+        /**
+         * @brief Operatore di assegnamento per spostamento
+         * 
+         * Distrugge gli elementi correnti e prende possesso di quelli di other, che resta vuoto.
+         * La memoria di other viene trasferita se l'allocatore si propaga o è uguale al nostro,
+         * altrimenti gli elementi sono spostati uno a uno in memoria ottenuta dal nostro allocatore.
+        **/
+        cbuffer &operator=(cbuffer &&other) noexcept(N == 0 ?
+                (alloc_traits::propagate_on_container_move_assignment::value || alloc_traits::is_always_equal::value) :
+                std::is_nothrow_move_constructible<T>::value) {
+            if(this != &other) {
+                if(N != 0) {
+                    clear();
+                    move_elements(other);
+                }
+                else if constexpr(alloc_traits::propagate_on_container_move_assignment::value) {
+                    release_storage();
+                    _alloc = std::move(other._alloc);
+                    swap_storage(other);
+                }
+                else if(_alloc == other._alloc) {
+                    release_storage();
+                    swap_storage(other);
+                }
+                else {
+                    cbuffer tmp(_alloc);
+                    tmp.init_storage(other._capacity);
+                    tmp.move_elements(other);
+                    swap_storage(tmp);
+                }
+            }
+
+            return *this;
         }
 
         /**
@@ -104,23 +213,24 @@ class cbuffer {
          * di tipo diverso da T. La conversione da Q a T è lasciata al compilatore.
          * @param begin Iteratore di inizio sequenza
          * @param end Iteratore di fine sequenza
-         * @param dim Dimensione del buffer
+         * @param dim Dimensione del buffer (ignorata se N != 0)
+         * @param alloc allocatore da cui ottenere la memoria
          * @throw Eccezione di allocazione memoria
         **/
         template <typename IterT>
-        cbuffer(IterT begin, IterT end, unsigned int dim) : _buffer(0), _head(0), _size(0), _capacity(0) {
+        cbuffer(IterT begin, IterT end, unsigned int dim, const Alloc &alloc = Alloc())
+                : _buffer(0), _capacity(0), _head(0), _size(0), _alloc(alloc) {
+            init_storage(dim);
             try {
-                _buffer = new T[dim];
+                while(begin != end) {
+                    this->insert(*begin);
+                    begin++;
+                }
             }
             catch(...) {
+                release_storage();
                 throw;
             }
-            _capacity = dim;
-            size_type index = 0;
-            while(begin != end) {
-                this->insert(*begin);
-                begin++;
-            }
         }
 
         /**
@@ -129,49 +239,128 @@ class cbuffer {
          * Distruttore della classe cbuffer
         **/
         ~cbuffer() {
-            delete[] _buffer;
-            _buffer = 0;
-            _capacity = 0;
-            _head = 0;
-            _size = 0;
+            release_storage();
+        }
 
-            #ifndef NDEBUG
-            std::cout << "cbuffer::~cbuffer()" << std::endl;
-            #endif
+        /**
+         * @brief Allocatore del buffer
+         * 
+         * @return Una copia dell'allocatore usato dal buffer
+        **/
+        allocator_type get_allocator() const {
+            return _alloc;
         }
 
         /**
          * @brief Operatore di accesso all'elemento index-esimo
          * 
-         * Permette di accedere all'elemento index-esimo del cbuffer in lettura e scrittura
+         * Permette di accedere all'elemento index-esimo del cbuffer in lettura e scrittura.
+         * L'indice non viene controllato (solo assert in debug): per l'accesso controllato usare at().
+         * @pre index < size()
          * @param index l'indice della posizione del buffer a cui si vuole accedere
-         * @throw std::out_of_range se index >= _size
         **/
         T &operator[](size_type index) {
-            try {
-                return _buffer[to_phisycal(index)];
-            }
-            catch(...) {
-                throw;
-            }
+            assert(index < _size);
+            return _buffer[wrap(_head + index)];
         }
 
         /**
          * @brief Operatore di accesso all'elemento index-esimo
          * 
-         * Permette di accedere all'elemento index-esimo del cbuffer in sola lettura
+         * Permette di accedere all'elemento index-esimo del cbuffer in sola lettura.
+         * L'indice non viene controllato (solo assert in debug): per l'accesso controllato usare at().
+         * @pre index < size()
          * @param index l'indice della posizione del buffer a cui si vuole accedere
-         * @throw std::out_of_range se index >= _size
         **/
         const T &operator[](size_type index) const {
-		    try {
-                return _buffer[to_phisycal(index)];
-            }
-            catch(...) {
-                throw;
-            }
+            assert(index < _size);
+            return _buffer[wrap(_head + index)];
 	    }
 
+        /**
+         * @brief Accesso controllato all'elemento index-esimo
+         * 
+         * Permette di accedere all'elemento index-esimo del cbuffer in lettura e scrittura,
+         * verificando l'indice.
+         * @param index l'indice della posizione del buffer a cui si vuole accedere
+         * @throw std::out_of_range se index >= _size
+        **/
+        T &at(size_type index) {
+            return _buffer[to_phisycal(index)];
+        }
+
+        /**
+         * @brief Accesso controllato all'elemento index-esimo in sola lettura
+         * 
+         * @param index l'indice della posizione del buffer a cui si vuole accedere
+         * @throw std::out_of_range se index >= _size
+        **/
+        const T &at(size_type index) const {
+            return _buffer[to_phisycal(index)];
+        }
+
+        /**
+         * @brief Elemento in testa
+         * 
+         * Ritorna l'elemento più vecchio del buffer, senza controlli.
+         * @pre Il buffer non deve essere vuoto
+        **/
+        T &front() {
+            assert(_size != 0);
+            return _buffer[_head];
+        }
+
+        /**
+         * @brief Elemento in testa in sola lettura
+         * 
+         * @pre Il buffer non deve essere vuoto
+        **/
+        const T &front() const {
+            assert(_size != 0);
+            return _buffer[_head];
+        }
+
+        /**
+         * @brief Elemento in coda
+         * 
+         * Ritorna l'elemento più recente del buffer, senza controlli.
+         * @pre Il buffer non deve essere vuoto
+        **/
+        T &back() {
+            assert(_size != 0);
+            return _buffer[wrap(_head + _size - 1)];
+        }
+
+        /**
+         * @brief Elemento in coda in sola lettura
+         * 
+         * @pre Il buffer non deve essere vuoto
+        **/
+        const T &back() const {
+            assert(_size != 0);
+            return _buffer[wrap(_head + _size - 1)];
+        }
+
+        /**
+         * @brief Accesso all'array sottostante
+         * 
+         * Ritorna il puntatore all'array fisico del buffer. Gli elementi presenti occupano
+         * le posizioni [head(), capacity()) e [0, tail()) se il buffer gira (vedi array_one e array_two).
+         * @return Il puntatore al primo slot dell'array
+        **/
+        T *data() {
+            return _buffer;
+        }
+
+        /**
+         * @brief Accesso all'array sottostante in sola lettura
+         * 
+         * @return Il puntatore al primo slot dell'array
+        **/
+        const T *data() const {
+            return _buffer;
+        }
+
         /**
          * @brief Operatore di uguaglianza
          * 
@@ -219,7 +408,7 @@ class cbuffer {
          * @return La dimensione dell'array dinamico.
         **/
         size_type capacity() const {
-            return _capacity;
+            return (N != 0) ? N : _capacity;
         }
 
         /**
@@ -249,78 +438,584 @@ class cbuffer {
          * @return L'indice in cui è memorizzata la coda del buffer
         **/
         size_type tail() const {
-            return (_head + _size) % capacity;
+            return wrap(_head + _size);
         }
 
         /**
          * @brief Accesso in lettura/scrittura
          * 
-         * Metodo getter per l'accesso all'index-esimo elemento del buffer
+         * Metodo getter per l'accesso all'index-esimo elemento del buffer, senza controlli
          * @pre E' necessario che index sia minore di _size
          * @param index Un indice del buffer
          * @return L'index-esimo elemento del buffer
         **/
         T &value(size_type index) const {
-            try {
-                return _buffer[to_phisycal(index)];
+            assert(index < _size);
+            return _buffer[wrap(_head + index)];
+        }
+
+        /**
+         * @brief Inserimento di un nuovo elemento
+         * 
+         * Metodo per inserire un nuovo elemento in coda al buffer.
+         * Se il buffer è pieno l'elemento più vecchio viene sovrascritto per assegnamento.
+         * @param value Un elemento da inserire
+        **/
+        void insert(const T &value) {
+            if(_size == capacity()) {
+                _buffer[_head] = value;
+                overwritten();
             }
-            catch(...) {
-                throw;
+            else {
+                const size_type slot = wrap(_head + _size);
+                construct(_buffer + slot, value);
+                _size++;
+                _counters.inserted(slot, _size, capacity());
             }
         }
 
         /**
-         * @brief Inserimento di un nuovo elemento
+         * @brief Inserimento per spostamento
+         * 
+         * Come insert(const T&), ma l'elemento viene spostato nel buffer invece di essere copiato.
+         * @param value Un elemento da spostare nel buffer
+        **/
+        void insert(T &&value) {
+            if(_size == capacity()) {
+                _buffer[_head] = std::move(value);
+                overwritten();
+            }
+            else {
+                const size_type slot = wrap(_head + _size);
+                construct(_buffer + slot, std::move(value));
+                _size++;
+                _counters.inserted(slot, _size, capacity());
+            }
+        }
+
+        /**
+         * @brief Inserimento senza sovrascrittura
+         * 
+         * Inserisce un elemento in coda solo se il buffer non è pieno.
+         * @param value Un elemento da inserire
+         * @return true se l'elemento è stato inserito, false se il buffer è pieno
+        **/
+        bool try_insert(const T &value) {
+            if(_size == capacity())
+                return false;
+            const size_type slot = wrap(_head + _size);
+            construct(_buffer + slot, value);
+            _size++;
+            _counters.inserted(slot, _size, capacity());
+            return true;
+        }
+
+        /**
+         * @brief Inserimento per spostamento senza sovrascrittura
+         * 
+         * @param value Un elemento da spostare nel buffer
+         * @return true se l'elemento è stato inserito, false se il buffer è pieno
+        **/
+        bool try_insert(T &&value) {
+            if(_size == capacity())
+                return false;
+            const size_type slot = wrap(_head + _size);
+            construct(_buffer + slot, std::move(value));
+            _size++;
+            _counters.inserted(slot, _size, capacity());
+            return true;
+        }
+
+        /**
+         * @brief Costruzione in coda di un nuovo elemento
+         * 
+         * Costruisce un nuovo elemento direttamente nello slot di coda, inoltrando gli argomenti
+         * al costruttore di T. Se il buffer è pieno l'elemento più vecchio viene sostituito
+         * da un temporaneo costruito con gli stessi argomenti.
+         * @param args Argomenti del costruttore di T
+        **/
+        template <typename... Args>
+        void emplace(Args&&... args) {
+            if(_size == capacity()) {
+                _buffer[_head] = T(std::forward<Args>(args)...);
+                overwritten();
+            }
+            else {
+                const size_type slot = wrap(_head + _size);
+                construct(_buffer + slot, std::forward<Args>(args)...);
+                _size++;
+                _counters.inserted(slot, _size, capacity());
+            }
+        }
+
+        /** Rimozione di un elemento
+         * 
+         * Rimuove un elemento dalla testa del buffer e lo distrugge
+        **/
+        void remove() {
+            if(_size != 0) {
+                _counters.removed(_head);
+                destroy(_buffer + _head);
+                _head = wrap(_head + 1);
+                _size--;
+            }  
+        }
+
+        /**
+         * @brief Rimozione dell'elemento più recente
+         *
+         * Rimuove l'elemento in coda al buffer, se presente, e lo distrugge.
+         * Permette di usare il cbuffer come deque limitata.
+        **/
+        void remove_back() {
+            if(_size != 0) {
+                const size_type slot = wrap(_head + _size - 1);
+                _counters.removed(slot);
+                destroy(_buffer + slot);
+                _size--;
+            }
+        }
+
+        /**
+         * @brief Estrazione dell'elemento in testa
+         * 
+         * Sposta fuori dal buffer l'elemento in testa e lo rimuove.
+         * @return L'elemento che si trovava in testa al buffer
+         * @throw std::out_of_range se il buffer è vuoto
+        **/
+        T pop() {
+            if(_size == 0)
+                throw std::out_of_range("Empty buffer");
+            T value(std::move(_buffer[_head]));
+            remove();
+            return value;
+        }
+
+        /**
+         * @brief Estrazione dell'elemento in testa senza eccezioni
+         * 
+         * Se il buffer non è vuoto sposta l'elemento in testa in value e lo rimuove.
+         * @param value Reference in cui viene spostato l'elemento estratto
+         * @return true se un elemento è stato estratto, false se il buffer è vuoto
+        **/
+        bool try_pop(T &value) {
+            if(_size == 0)
+                return false;
+            value = std::move(_buffer[_head]);
+            remove();
+            return true;
+        }
+
+        /**
+         * @brief Svuotamento del buffer
+         * 
+         * Distrugge tutti gli elementi presenti. La capacità non cambia.
+        **/
+        void clear() {
+            if(!std::is_trivially_destructible<T>::value)
+                for(size_type i = 0; i < _size; i++)
+                    destroy(_buffer + wrap(_head + i));
+            _head = 0;
+            _size = 0;
+        }
+
+        /**
+         * @brief Inserimento di una sequenza di elementi
+         * 
+         * Inserisce in coda gli elementi di [first, last) con la stessa politica di insert:
+         * se non c'è spazio vengono eliminati gli elementi più vecchi, e di una sequenza
+         * più lunga della capacità restano solo gli ultimi capacity() elementi.
+         * La copia avviene in al più due blocchi contigui, con memcpy se T è banalmente copiabile.
+         * @param first Iteratore di inizio sequenza
+         * @param last Iteratore di fine sequenza
+        **/
+        template <typename ForwardIt>
+        void insert_range(ForwardIt first, ForwardIt last) {
+            const size_type cap = capacity();
+            size_type n = static_cast<size_type>(std::distance(first, last));
+            if(cap == 0 || n == 0)
+                return;
+            if(n > cap) {
+                std::advance(first, n - cap);
+                n = cap;
+            }
+            if(n > cap - _size) {
+                _counters.evicted(n - (cap - _size));
+                drop_front(n - (cap - _size));
+            }
+
+            const size_type tail = wrap(_head + _size);
+            const size_type one = std::min(n, cap - tail);
+            construct_range(_buffer + tail, first, one);
+            _size += one;
+            std::advance(first, one);
+            construct_range(_buffer, first, n - one);
+            _size += n - one;
+            count_inserted(n);
+        }
+
+        /**
+         * @brief Scrittura di un array di elementi
+         * 
+         * Inserisce in coda n elementi consecutivi, come insert_range(src, src + n).
+         * @param src Puntatore al primo elemento da inserire
+         * @param n Numero di elementi da inserire
+        **/
+        void write(const T *src, size_type n) {
+            insert_range(src, src + n);
+        }
+
+        /**
+         * @brief Lettura di un blocco di elementi
+         * 
+         * Sposta in dst fino a n elementi dalla testa del buffer e li rimuove.
+         * La copia avviene in al più due blocchi contigui, con memcpy se T è banalmente copiabile.
+         * @param dst Puntatore ad un array di almeno n elementi già costruiti
+         * @param n Numero massimo di elementi da leggere
+         * @return Il numero di elementi letti
+        **/
+        size_type read(T *dst, size_type n) {
+            if(n > _size)
+                n = _size;
+            const size_type one = std::min(n, capacity() - _head);
+            move_range(_buffer + _head, one, dst);
+            move_range(_buffer, n - one, dst + one);
+            count_removed(n);
+            drop_front(n);
+            return n;
+        }
+
+        /**
+         * @brief Svuotamento verso un iteratore di output
+         * 
+         * Sposta tutti gli elementi, dal più vecchio al più recente, nella sequenza che
+         * inizia da out e svuota il buffer.
+         * @param out Iteratore di output
+         * @return L'iteratore successivo all'ultimo elemento scritto
+        **/
+        template <typename OutputIt>
+        OutputIt drain_to(OutputIt out) {
+            const array_range one = array_one();
+            const array_range two = array_two();
+            out = std::move(one.first, one.first + one.second, out);
+            out = std::move(two.first, two.first + two.second, out);
+            count_removed(_size);
+            clear();
+            return out;
+        }
+
+#ifdef CBUFFER_FD_IO
+        /**
+         * @brief Elemento trasferito a metà da read_from_fd o write_to_fd
+         * 
+         * Quando readv o writev si fermano a metà di un elemento i suoi byte vengono conservati
+         * qui, fuori dal buffer, e il trasferimento viene completato dalla chiamata successiva
+         * invece di attendere il descrittore: il buffer contiene sempre elementi interi.
+         * Ogni flusso (descrittore e direzione) richiede il proprio oggetto.
+        **/
+        struct fd_partial {
+            alignas(T) unsigned char data[sizeof(T)];
+            size_type done;  // byte dell'elemento già trasferiti
+
+            fd_partial() : done(0) {
+            }
+
+            /**
+             * @brief true se un elemento attende di essere completato
+            **/
+            bool pending() const {
+                return done != 0;
+            }
+        };
+
+        /**
+         * @brief Lettura da un descrittore nello spazio libero
+         * 
+         * Legge fino a max elementi da fd direttamente nello spazio libero del buffer, con
+         * un'unica readv sui due blocchi liberi (prima e dopo il punto di giro), e li aggiunge
+         * in coda senza sovrascrivere. I byte di un elemento letto solo in parte restano in
+         * partial: la chiamata successiva lo completa e lo inserisce prima di leggere altri
+         * elementi. Su un descrittore non bloccante la funzione non attende mai.
+         * Solo per T banalmente copiabile.
+         * @param fd Descrittore da cui leggere
+         * @param max Numero massimo di elementi da leggere
+         * @param partial Stato dell'elemento incompleto, lo stesso a ogni chiamata su fd
+         * @return Il numero di elementi inseriti, 0 a fine file o se il buffer è pieno,
+         *         -1 se fd non è bloccante e non ci sono dati (errno EAGAIN)
+         * @throw std::system_error se la lettura fallisce
+         * @throw std::runtime_error se il file finisce a metà di un elemento
+        **/
+        std::ptrdiff_t read_from_fd(int fd, size_type max, fd_partial &partial) {
+            static_assert(std::is_trivially_copyable<T>::value, "read_from_fd richiede T banalmente copiabile");
+            const size_type cap = capacity();
+            size_type total = 0;
+            while(total < max) {
+                if(partial.done == sizeof(T)) {
+                    if(_size == cap)
+                        break;
+                    std::memcpy(static_cast<void*>(_buffer + wrap(_head + _size)), partial.data, sizeof(T));
+                    _size++;
+                    count_inserted(1);
+                    partial.done = 0;
+                    total++;
+                    continue;
+                }
+                if(partial.done != 0) {
+                    iovec iov = {partial.data + partial.done, sizeof(T) - partial.done};
+                    const ssize_t bytes = transfer_fd(fd, &iov, 1, true);
+                    if(bytes < 0)
+                        return total ? std::ptrdiff_t(total) : -1;
+                    if(bytes == 0)
+                        throw std::runtime_error("Truncated element");
+                    partial.done += static_cast<size_type>(bytes);
+                    continue;
+                }
+
+                const size_type n = std::min(max - total, cap - _size);
+                if(n == 0)
+                    break;
+                const size_type tail = wrap(_head + _size);
+                const size_type one = std::min(n, cap - tail);
+                iovec iov[2] = {{_buffer + tail, one * sizeof(T)}, {_buffer, (n - one) * sizeof(T)}};
+                const ssize_t bytes = transfer_fd(fd, iov, (n > one) ? 2 : 1, true);
+                if(bytes < 0)
+                    return total ? std::ptrdiff_t(total) : -1;
+                if(bytes == 0)
+                    break;
+                const size_type k = static_cast<size_type>(bytes / sizeof(T));
+                const size_type rest = static_cast<size_type>(bytes % sizeof(T));
+                _size += k;
+                count_inserted(k);
+                total += k;
+                if(rest != 0) {
+                    std::memcpy(partial.data, _buffer + wrap(_head + _size), rest);
+                    partial.done = rest;
+                }
+                //Se la readv ha letto solo parte di un elemento si prova a completarlo
+                if(k != 0)
+                    break;
+            }
+            return total;
+        }
+
+        /**
+         * @brief Scrittura su un descrittore degli elementi presenti
+         * 
+         * Completa prima l'elemento rimasto a metà in partial, poi scrive fino a max elementi
+         * dalla testa del buffer con un'unica writev sui due blocchi contigui e rimuove gli
+         * elementi accettati avanzando la testa. Se la writev accetta solo parte di un elemento,
+         * anche questo viene rimosso e copiato in partial, e la chiamata successiva ne scrive
+         * i byte restanti prima di ogni altro: sul descrittore gli elementi non si mescolano mai.
+         * Su un descrittore non bloccante la funzione non attende mai.
+         * Solo per T banalmente copiabile.
+         * @param fd Descrittore su cui scrivere
+         * @param max Numero massimo di elementi da scrivere
+         * @param partial Stato dell'elemento incompleto, lo stesso a ogni chiamata su fd
+         * @return Il numero di elementi rimossi (l'ultimo può essere ancora in partial),
+         *         -1 se fd non è bloccante e non accetta dati (errno EAGAIN)
+         * @throw std::system_error se la scrittura fallisce
+        **/
+        std::ptrdiff_t write_to_fd(int fd, size_type max, fd_partial &partial) {
+            static_assert(std::is_trivially_copyable<T>::value, "write_to_fd richiede T banalmente copiabile");
+            while(partial.done != 0) {
+                iovec iov = {partial.data + partial.done, sizeof(T) - partial.done};
+                const ssize_t bytes = transfer_fd(fd, &iov, 1, false);
+                if(bytes <= 0)
+                    return bytes;
+                partial.done += static_cast<size_type>(bytes);
+                if(partial.done == sizeof(T))
+                    partial.done = 0;
+            }
+
+            const size_type n = std::min(max, _size);
+            if(n == 0)
+                return 0;
+            const size_type one = std::min(n, capacity() - _head);
+            iovec iov[2] = {{_buffer + _head, one * sizeof(T)}, {_buffer, (n - one) * sizeof(T)}};
+            const ssize_t bytes = transfer_fd(fd, iov, (n > one) ? 2 : 1, false);
+            if(bytes < 0)
+                return -1;
+            size_type k = static_cast<size_type>(bytes / sizeof(T));
+            const size_type rest = static_cast<size_type>(bytes % sizeof(T));
+            if(rest != 0) {
+                std::memcpy(partial.data, _buffer + wrap(_head + k), sizeof(T));
+                partial.done = rest;
+                k++;
+            }
+            count_removed(k);
+            drop_front(k);
+            return k;
+        }
+#endif
+
+        /**
+         * @brief Primo blocco contiguo di elementi
+         * 
+         * Ritorna il blocco che va dalla testa del buffer fino alla fine dell'array
+         * (o fino all'ultimo elemento, se il buffer non gira).
+         * @return Coppia puntatore al primo elemento, numero di elementi
+        **/
+        array_range array_one() {
+            return array_range(_buffer + _head, std::min(_size, capacity() - _head));
+        }
+
+        /**
+         * @brief Primo blocco contiguo di elementi in sola lettura
+         * 
+         * @return Coppia puntatore al primo elemento, numero di elementi
+        **/
+        const_array_range array_one() const {
+            return const_array_range(_buffer + _head, std::min(_size, capacity() - _head));
+        }
+
+        /**
+         * @brief Secondo blocco contiguo di elementi
+         * 
+         * Ritorna il blocco che parte dall'inizio dell'array, presente solo se il buffer gira.
+         * @return Coppia puntatore al primo elemento, numero di elementi (eventualmente 0)
+        **/
+        array_range array_two() {
+            return array_range(_buffer, _size - std::min(_size, capacity() - _head));
+        }
+
+        /**
+         * @brief Secondo blocco contiguo di elementi in sola lettura
+         * 
+         * @return Coppia puntatore al primo elemento, numero di elementi (eventualmente 0)
+        **/
+        const_array_range array_two() const {
+            return const_array_range(_buffer, _size - std::min(_size, capacity() - _head));
+        }
+
+        /**
+         * @brief Riserva di capacità
+         *
+         * Se n è maggiore della capacità attuale rialloca il buffer con capacità n,
+         * spostando gli elementi presenti all'inizio della nuova memoria. Solo con N == 0.
+         * @param n Capacità minima richiesta
+         * @throw Eccezione di allocazione memoria (il buffer resta invariato)
+        **/
+        void reserve(size_type n) {
+            if(n > capacity())
+                reallocate(n);
+        }
+
+        /**
+         * @brief Modifica della capacità
+         *
+         * Rialloca il buffer con capacità n. Se n è minore della dimensione vengono
+         * eliminati gli elementi più vecchi, come farebbe insert. Solo con N == 0.
+         * @param n Nuova capacità
+         * @throw Eccezione di allocazione memoria
+        **/
+        void resize_capacity(size_type n) {
+            if(n != capacity())
+                reallocate(n);
+        }
+
+        /**
+         * @brief Riduzione della capacità alla dimensione
+         *
+         * Rialloca il buffer con capacità pari al numero di elementi presenti. Solo con N == 0.
+         * @throw Eccezione di allocazione memoria (il buffer resta invariato)
+        **/
+        void shrink_to_fit() {
+            if(_size != capacity())
+                reallocate(_size);
+        }
+
+        /**
+         * @brief Linearizzazione sul posto
+         *
+         * Riordina gli elementi nella memoria già allocata in modo che siano contigui,
+         * senza allocazioni. Se il buffer non gira gli elementi non vengono spostati.
+         * Gli iteratori restano validi, i puntatori agli elementi no.
+         * @return Il puntatore all'elemento in testa, seguito dagli altri size() - 1 elementi
+        **/
+        T *linearize() {
+            const size_type cap = capacity();
+            if(_head + _size <= cap)
+                return _buffer + _head;
+
+            if(_size == cap)
+                std::rotate(_buffer, _buffer + _head, _buffer + cap);
+            else {
+                //Il primo blocco [_head, cap) viene accostato al secondo [0, tail),
+                //poi i due blocchi adiacenti vengono scambiati con una rotazione
+                const size_type tail = _size - (cap - _head);
+                const size_type one = cap - _head;
+                if(std::is_trivially_copyable<T>::value)
+                    std::memmove(static_cast<void*>(_buffer + tail), _buffer + _head, one * sizeof(T));
+                else {
+                    for(size_type i = 0; i < one; i++) {
+                        //Gli slot prima della vecchia testa sono liberi, gli altri contengono
+                        //elementi del primo blocco già spostati
+                        if(tail + i < _head)
+                            construct(_buffer + tail + i, std::move(_buffer[_head + i]));
+                        else
+                            _buffer[tail + i] = std::move(_buffer[_head + i]);
+                    }
+                    if(!std::is_trivially_destructible<T>::value)
+                        for(size_type i = std::max(_head, _size); i < cap; i++)
+                            destroy(_buffer + i);
+                }
+                std::rotate(_buffer, _buffer + tail, _buffer + _size);
+            }
+            _head = 0;
+            _counters.relocated();
+            return _buffer;
+        }
+
+        /**
+         * @brief scambio tra cbuffer
          * 
-         * Metodo per inserire un nuovo elemento in coda al buffer.
-         * @param value Un elemento da inserire
+         * Funzione che effettua lo scambio di due cbuffer. Gli allocatori vengono scambiati
+         * solo se propagate_on_container_swap lo richiede, altrimenti devono essere uguali.
+         * Con N != 0 gli elementi sono interni all'oggetto e vengono spostati uno a uno.
+         * @param Un reference ad un cbuffer
         **/
-        void insert(const T &value) {
-            _buffer[(_head + _size) % _capacity] = value;
-            if(_size == _capacity)
-                _head = (_head + 1) % _capacity;
-            else
-                _size++;
+        void swap(cbuffer &other) {
+            if constexpr(alloc_traits::propagate_on_container_swap::value) {
+                using std::swap;
+                swap(_alloc, other._alloc);
+            }
+            swap_storage(other);
         }
 
-        /** Rimozione di un elemento
+        /**
+         * @brief Statistiche di utilizzo
          * 
-         * Rimuove un elemento dalla testa del buffer
+         * Inserimenti, rimozioni, sovrascritture, massimo riempimento, istogramma
+         * dell'occupazione e, con Stats == 2, latenza di permanenza degli elementi.
+         * Le statistiche seguono gli elementi negli spostamenti e negli scambi; la copia
+         * parte da zero. Con Stats == 0 (default) i campi valgono sempre zero.
+         * @return Una copia dei contatori
         **/
-        void remove() {
-            if(_size != 0) {
-                _head = (_head + 1) % _capacity;
-                _size--;
-            }  
+        cbuffer_stats stats() const {
+            return _counters.snapshot();
         }
 
         /**
-         * @brief scambio tra cbuffer
-         * 
-         * Funzione che effettua lo scambio di due cbuffer
-         * @param Un reference ad un cbuffer
+         * @brief Azzeramento delle statistiche
         **/
-        void swap(cbuffer &other) {
-            std::swap(this->_buffer, other._buffer);
-            std::swap(this->_capacity, other._capacity);
-            std::swap(this->_head, other._head);
-            std::swap(this->_size, other._size);
+        void reset_stats() {
+            _counters.reset();
         }
 
         class iterator {
             private:
                 const cbuffer *cb;
-                unsigned int offset;
+                size_type offset;
 
                 friend class cbuffer;
                 friend class const_iterator;
 
                 //Costruttore utilizzato da begin e end
-                iterator(cbuffer* c, unsigned int o) : cb(c), offset(o) {
+                iterator(const cbuffer* c, size_type o) : cb(c), offset(o) {
                 }
             
             public:
-                typedef std::forward_iterator_tag iterator_category;
+                typedef std::random_access_iterator_tag iterator_category;
 		        typedef T                         value_type;
 		        typedef ptrdiff_t                 difference_type;
 		        typedef T*                        pointer;
@@ -349,14 +1044,19 @@ class cbuffer {
                 //Distruttore
                 ~iterator() {}
 
-                //Ritorna il dato riferito dall'iteratore (dereferenziamento)
+                //Ritorna il dato riferito dall'iteratore (dereferenziamento, senza controlli sull'indice)
                 reference operator*() const {
-                    return *(cb->_buffer + cb->to_phisycal(offset));
+                    return cb->_buffer[cb->wrap(cb->_head + offset)];
                 }
 
                 //Ritorna il puntatore al dato riferito dall'iteratore
                 pointer operator->() const {
-                    return cb._buffer + to_phisycal(offset);
+                    return &**this;
+                }
+
+                //Ritorna il dato a distanza n dall'iteratore
+                reference operator[](difference_type n) const {
+                    return *(*this + n);
                 }
 
                 //Operatore di pre-incremento
@@ -372,6 +1072,51 @@ class cbuffer {
                     return tmp;
                 }
 
+                //Operatore di pre-decremento
+                iterator& operator--() {
+                    offset--;
+                    return *this;
+                }
+
+                //Operatore di post-decremento
+                iterator operator--(int) {
+                    iterator tmp(*this);
+                    offset--;
+                    return tmp;
+                }
+
+                //Avanzamento di n posizioni
+                iterator& operator+=(difference_type n) {
+                    offset += n;
+                    return *this;
+                }
+
+                //Arretramento di n posizioni
+                iterator& operator-=(difference_type n) {
+                    offset -= n;
+                    return *this;
+                }
+
+                //Iteratore a distanza n in avanti
+                iterator operator+(difference_type n) const {
+                    return iterator(cb, offset + n);
+                }
+
+                //Iteratore a distanza n in avanti (n + iteratore)
+                friend iterator operator+(difference_type n, const iterator &it) {
+                    return it + n;
+                }
+
+                //Iteratore a distanza n all'indietro
+                iterator operator-(difference_type n) const {
+                    return iterator(cb, offset - n);
+                }
+
+                //Distanza tra due iteratori
+                difference_type operator-(const iterator &other) const {
+                    return difference_type(offset) - difference_type(other.offset);
+                }
+
                 //Operatore di uguaglianza (due iteratori)
 		        bool operator==(const iterator &other) const {
 			        return (cb == other.cb && offset == other.offset);
@@ -391,8 +1136,27 @@ class cbuffer {
                 bool operator!=(const const_iterator &other) const {
 			        return (cb != other.cb || offset != other.offset);
 		        }
+
+                //Operatori di confronto (iteratori dello stesso cbuffer)
+                bool operator<(const iterator &other) const {
+                    return offset < other.offset;
+                }
+
+                bool operator>(const iterator &other) const {
+                    return offset > other.offset;
+                }
+
+                bool operator<=(const iterator &other) const {
+                    return offset <= other.offset;
+                }
+
+                bool operator>=(const iterator &other) const {
+                    return offset >= other.offset;
+                }
         };
 
+        typedef std::reverse_iterator<iterator> reverse_iterator;
+
         /**
          * @brief Iteratore di inizio sequenza
          * 
@@ -411,24 +1175,42 @@ class cbuffer {
             return iterator(this, _size);
         }
 
+        /**
+         * @brief Iteratore inverso di inizio sequenza
+         * 
+         * Ritorna l'iteratore che parte dall'elemento più recente del cbuffer
+        **/
+        reverse_iterator rbegin() {
+            return reverse_iterator(end());
+        }
+
+        /**
+         * @brief Iteratore inverso di fine sequenza
+         * 
+         * Ritorna l'iteratore che segue l'elemento più vecchio del cbuffer
+        **/
+        reverse_iterator rend() {
+            return reverse_iterator(begin());
+        }
+
         class const_iterator {
             private:
-                const cbuffer * const cb;
-                unsigned int offset;
+                const cbuffer *cb;
+                size_type offset;
 
                 friend class cbuffer;
                 friend class iterator;
 
                 //Costruttore utilizzato da begin e end
-                const_iterator(cbuffer* c, unsigned int o) : cb(c), offset(o) {
+                const_iterator(const cbuffer* c, size_type o) : cb(c), offset(o) {
                 }
             
             public:
-                typedef std::forward_iterator_tag iterator_category;
+                typedef std::random_access_iterator_tag iterator_category;
 		        typedef T                         value_type;
 		        typedef ptrdiff_t                 difference_type;
-		        typedef T*                        pointer;
-		        typedef T&                        reference;
+		        typedef const T*                  pointer;
+		        typedef const T&                  reference;
                 
                 //Costruttore di default
                 const_iterator() : cb(NULL), offset(0) {}
@@ -458,14 +1240,19 @@ class cbuffer {
                 //Distruttore
                 ~const_iterator() {}
 
-                //Ritorna il dato riferito dall'iteratore (dereferenziamento)
+                //Ritorna il dato riferito dall'iteratore (dereferenziamento, senza controlli sull'indice)
                 reference operator*() const {
-                    return *(cb->_buffer + cb->to_phisycal(offset));
+                    return cb->_buffer[cb->wrap(cb->_head + offset)];
                 }
                 
                 //Ritorna il puntatore al dato riferito dall'iteratore
                 pointer operator->() const {
-                    return cb._buffer + to_phisycal(offset);
+                    return &**this;
+                }
+
+                //Ritorna il dato a distanza n dall'iteratore
+                reference operator[](difference_type n) const {
+                    return *(*this + n);
                 }
 
                 //Operatore di pre-incremento
@@ -481,6 +1268,51 @@ class cbuffer {
                     return tmp;
                 }
 
+                //Operatore di pre-decremento
+                const_iterator& operator--() {
+                    offset--;
+                    return *this;
+                }
+
+                //Operatore di post-decremento
+                const_iterator operator--(int) {
+                    const_iterator tmp(*this);
+                    offset--;
+                    return tmp;
+                }
+
+                //Avanzamento di n posizioni
+                const_iterator& operator+=(difference_type n) {
+                    offset += n;
+                    return *this;
+                }
+
+                //Arretramento di n posizioni
+                const_iterator& operator-=(difference_type n) {
+                    offset -= n;
+                    return *this;
+                }
+
+                //Iteratore a distanza n in avanti
+                const_iterator operator+(difference_type n) const {
+                    return const_iterator(cb, offset + n);
+                }
+
+                //Iteratore a distanza n in avanti (n + iteratore)
+                friend const_iterator operator+(difference_type n, const const_iterator &it) {
+                    return it + n;
+                }
+
+                //Iteratore a distanza n all'indietro
+                const_iterator operator-(difference_type n) const {
+                    return const_iterator(cb, offset - n);
+                }
+
+                //Distanza tra due iteratori
+                difference_type operator-(const const_iterator &other) const {
+                    return difference_type(offset) - difference_type(other.offset);
+                }
+
                 //Operatore di uguaglianza (due iteratori costanti)
                 bool operator==(const const_iterator &other) const {
 			        return (cb == other.cb && offset == other.offset);
@@ -500,8 +1332,27 @@ class cbuffer {
                 bool operator!=(const iterator &other) const {
 			        return (cb != other.cb || offset != other.offset);
 		        }
+
+                //Operatori di confronto (iteratori dello stesso cbuffer)
+                bool operator<(const const_iterator &other) const {
+                    return offset < other.offset;
+                }
+
+                bool operator>(const const_iterator &other) const {
+                    return offset > other.offset;
+                }
+
+                bool operator<=(const const_iterator &other) const {
+                    return offset <= other.offset;
+                }
+
+                bool operator>=(const const_iterator &other) const {
+                    return offset >= other.offset;
+                }
         };
 
+        typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
         /**
          * @brief Iteratore costante di inizio sequenza
          * 
@@ -520,12 +1371,339 @@ class cbuffer {
             return const_iterator(this, _size);
         }
 
+        /**
+         * @brief Iteratore inverso costante di inizio sequenza
+         * 
+         * Ritorna l'iteratore costante che parte dall'elemento più recente del cbuffer
+        **/
+        const_reverse_iterator rbegin() const {
+            return const_reverse_iterator(end());
+        }
+
+        /**
+         * @brief Iteratore inverso costante di fine sequenza
+         * 
+         * Ritorna l'iteratore costante che segue l'elemento più vecchio del cbuffer
+        **/
+        const_reverse_iterator rend() const {
+            return const_reverse_iterator(begin());
+        }
+
 
     private:
         T* _buffer;
         size_type _capacity;
         size_type _head;
         size_type _size;
+        cbuffer_storage<T, N> _storage;
+        Alloc _alloc;
+        [[no_unique_address]] cbuffer_counters<Stats> _counters;
+
+        /**
+         * @brief Inizializzazione della memoria
+         * 
+         * Con N == 0 alloca sullo heap memoria non inizializzata per capacity elementi,
+         * altrimenti usa lo spazio interno all'oggetto. Nessun elemento viene costruito.
+         * @param capacity capacità richiesta (ignorata se N != 0)
+         * @throw Eccezione di allocazione memoria
+        **/
+        void init_storage(size_type capacity) {
+            if(N != 0) {
+                _buffer = _storage.data();
+                _capacity = N;
+            }
+            else {
+                _buffer = (capacity != 0) ? alloc_traits::allocate(_alloc, capacity) : 0;
+                _capacity = capacity;
+            }
+            _counters.resize(_capacity);
+        }
+
+        /**
+         * @brief Rilascio della memoria
+         * 
+         * Distrugge gli elementi presenti, dealloca la memoria allocata da init_storage
+         * e azzera lo stato del buffer.
+        **/
+        void release_storage() {
+            clear();
+            if(N == 0 && _buffer != 0)
+                alloc_traits::deallocate(_alloc, _buffer, _capacity);
+            _buffer = 0;
+            _capacity = 0;
+            _head = 0;
+            _size = 0;
+        }
+
+        /**
+         * @brief Riallocazione della memoria
+         *
+         * Alloca capacity slot, vi sposta gli elementi presenti a partire dall'indice 0
+         * e rilascia la vecchia memoria. Se capacity è minore della dimensione vengono
+         * prima eliminati gli elementi più vecchi. I due blocchi vengono copiati con memcpy
+         * se T è banalmente copiabile, altrimenti spostati (copiati se lo spostamento può
+         * lanciare eccezioni, così un fallimento lascia il buffer invariato).
+         * @param capacity nuova capacità
+         * @throw Eccezione di allocazione memoria
+        **/
+        void reallocate(size_type capacity) {
+            static_assert(N == 0, "la capacità di un cbuffer con N != 0 non è modificabile");
+            T *buffer = (capacity != 0) ? alloc_traits::allocate(_alloc, capacity) : 0;
+            if(capacity < _size) {
+                _counters.evicted(_size - capacity);
+                drop_front(_size - capacity);
+            }
+
+            const array_range one = array_one();
+            const array_range two = array_two();
+            if(std::is_trivially_copyable<T>::value) {
+                if(one.second != 0)
+                    std::memcpy(static_cast<void*>(buffer), one.first, one.second * sizeof(T));
+                if(two.second != 0)
+                    std::memcpy(static_cast<void*>(buffer + one.second), two.first, two.second * sizeof(T));
+            }
+            else {
+                size_type i = 0;
+                try {
+                    for(; i < _size; i++)
+                        construct(buffer + i, std::move_if_noexcept(_buffer[wrap(_head + i)]));
+                }
+                catch(...) {
+                    while(i != 0)
+                        destroy(buffer + --i);
+                    alloc_traits::deallocate(_alloc, buffer, capacity);
+                    throw;
+                }
+            }
+
+            const size_type size = _size;
+            release_storage();
+            _buffer = buffer;
+            _capacity = capacity;
+            _size = size;
+            _counters.resize(capacity);
+        }
+
+        /**
+         * @brief Copia iniziale
+         * 
+         * Usata dai costruttori di copia: alloca la memoria e copia gli elementi di other.
+         * @param other cbuffer da copiare
+        **/
+        void init_copy(const cbuffer &other) {
+            init_storage(other._capacity);
+            try{
+                copy_elements(other);
+            }
+            catch(...){
+                release_storage();
+                throw;
+            }
+        }
+
+        /**
+         * @brief Scambio della memoria
+         * 
+         * Scambia elementi, capacità, testa e dimensione, senza toccare gli allocatori.
+        **/
+        void swap_storage(cbuffer &other) {
+            if(N != 0) {
+                if(this != &other) {
+                    cbuffer tmp(std::move(*this));
+                    move_elements(other);
+                    other.move_elements(tmp);
+                }
+                return;
+            }
+            std::swap(this->_buffer, other._buffer);
+            std::swap(this->_capacity, other._capacity);
+            std::swap(this->_head, other._head);
+            std::swap(this->_size, other._size);
+            _counters.swap(other._counters);
+        }
+
+        /**
+         * @brief Costruzione di un elemento
+         * 
+         * Costruisce un elemento nello slot p tramite l'allocatore.
+        **/
+        template <typename... Args>
+        void construct(T *p, Args&&... args) {
+            alloc_traits::construct(_alloc, p, std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Distruzione di un elemento
+         * 
+         * Distrugge l'elemento nello slot p tramite l'allocatore.
+        **/
+        void destroy(T *p) {
+            alloc_traits::destroy(_alloc, p);
+        }
+
+        /**
+         * @brief Copia degli elementi presenti
+         * 
+         * Costruisce per copia gli elementi di other nelle stesse posizioni fisiche.
+         * Il buffer deve essere vuoto e avere la stessa capacità di other.
+         * Se una copia fallisce gli elementi già costruiti restano nel buffer.
+         * @param other cbuffer da cui copiare
+        **/
+        void copy_elements(const cbuffer &other) {
+            _head = other._head;
+            _size = 0;
+            for(size_type i = 0; i < other._size; i++) {
+                const size_type p = wrap(other._head + i);
+                construct(_buffer + p, other._buffer[p]);
+                _size++;
+            }
+        }
+
+        /**
+         * @brief Spostamento degli elementi presenti
+         * 
+         * Costruisce per spostamento gli elementi di other nelle stesse posizioni fisiche
+         * e svuota other, scambiando con lui le statistiche. Il buffer deve essere vuoto e avere la stessa capacità di other.
+         * @param other cbuffer da cui spostare
+        **/
+        void move_elements(cbuffer &other) {
+            _head = other._head;
+            _size = 0;
+            for(size_type i = 0; i < other._size; i++) {
+                const size_type p = wrap(other._head + i);
+                construct(_buffer + p, std::move(other._buffer[p]));
+                _size++;
+            }
+            other.clear();
+            _counters.swap(other._counters);
+            _counters.relocated();
+        }
+
+        /**
+         * @brief Rimozione di più elementi dalla testa
+         * 
+         * Distrugge i primi n elementi del buffer (n <= _size) e avanza la testa.
+         * @param n numero di elementi da rimuovere
+        **/
+        void drop_front(size_type n) {
+            if(!std::is_trivially_destructible<T>::value)
+                for(size_type i = 0; i < n; i++)
+                    destroy(_buffer + wrap(_head + i));
+            _head = (n == _size) ? 0 : wrap(_head + n);
+            _size -= n;
+        }
+
+#ifdef CBUFFER_FD_IO
+        /**
+         * @brief Una readv o writev, ripetuta dopo EINTR
+         * 
+         * @return I byte trasferiti, -1 se fd non è bloccante e non è pronto (errno EAGAIN)
+         * @throw std::system_error se il trasferimento fallisce
+        **/
+        static ssize_t transfer_fd(int fd, const iovec *iov, int count, bool reading) {
+            ssize_t bytes;
+            do
+                bytes = reading ? readv(fd, iov, count) : writev(fd, iov, count);
+            while(bytes < 0 && errno == EINTR);
+            if(bytes < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+                throw std::system_error(errno, std::generic_category(), reading ? "readv" : "writev");
+            return bytes;
+        }
+#endif
+
+        /**
+         * @brief Sovrascrittura dell'elemento più vecchio
+         * 
+         * Avanza la testa dopo che l'elemento in testa è stato sostituito dal nuovo,
+         * che diventa il più recente, e aggiorna i contatori.
+        **/
+        void overwritten() {
+            _counters.evicted(1);
+            _counters.inserted(_head, _size, capacity());
+            _head = wrap(_head + 1);
+        }
+
+        /**
+         * @brief Contatori degli ultimi n elementi inseriti in coda
+        **/
+        void count_inserted(size_type n) {
+            if constexpr(Stats != 0)
+                for(size_type i = _size - n; i < _size; i++)
+                    _counters.inserted(wrap(_head + i), i + 1, capacity());
+        }
+
+        /**
+         * @brief Contatori dei primi n elementi, prima della loro rimozione
+        **/
+        void count_removed(size_type n) {
+            if constexpr(Stats != 0)
+                for(size_type i = 0; i < n; i++)
+                    _counters.removed(wrap(_head + i));
+        }
+
+        /**
+         * @brief Costruzione di un blocco contiguo
+         * 
+         * Costruisce per copia n elementi a partire da first nella memoria non inizializzata dst.
+         * Se first è un puntatore a T banalmente copiabile la copia è un'unica memcpy.
+         * Se una costruzione fallisce gli elementi già costruiti vengono distrutti.
+         * @param dst destinazione non inizializzata
+         * @param first sorgente
+         * @param n numero di elementi
+        **/
+        template <typename ForwardIt>
+        void construct_range(T *dst, ForwardIt first, size_type n) {
+            typedef typename std::remove_cv<typename std::remove_pointer<ForwardIt>::type>::type source_type;
+            if(std::is_pointer<ForwardIt>::value && std::is_same<source_type, T>::value &&
+               std::is_trivially_copyable<T>::value) {
+                if(n != 0)
+                    std::memcpy(static_cast<void*>(dst), &*first, n * sizeof(T));
+                return;
+            }
+            size_type i = 0;
+            try {
+                for(; i < n; ++i, ++first)
+                    construct(dst + i, *first);
+            }
+            catch(...) {
+                while(i != 0)
+                    destroy(dst + --i);
+                throw;
+            }
+        }
+
+        /**
+         * @brief Spostamento di un blocco contiguo
+         * 
+         * Sposta n elementi da src negli elementi già costruiti di dst.
+         * Se T è banalmente copiabile lo spostamento è un'unica memcpy.
+         * @param src sorgente
+         * @param n numero di elementi
+         * @param dst destinazione
+        **/
+        static void move_range(T *src, size_type n, T *dst) {
+            if(std::is_trivially_copyable<T>::value) {
+                if(n != 0)
+                    std::memcpy(static_cast<void*>(dst), src, n * sizeof(T));
+            }
+            else
+                std::move(src, src + n, dst);
+        }
+
+        /**
+         * @brief Riduzione di un indice fisico
+         * 
+         * Riporta nell'intervallo [0, capacity()) un indice minore di 2 * capacity(),
+         * senza divisioni: maschera se N è una potenza di due, altrimenti una sottrazione condizionale.
+         * @param i indice fisico minore di 2 * capacity()
+         * @return indice dell'array
+        **/
+        size_type wrap(size_type i) const {
+            if(N != 0 && (N & (N - 1)) == 0)
+                return i & (N - 1);
+            const size_type cap = capacity();
+            return (i >= cap) ? i - cap : i;
+        }
 
         /**
          * @brief Conversione dell'indice logico in fisico
@@ -537,7 +1715,7 @@ class cbuffer {
         **/
         size_type to_phisycal(size_type i) const {
             if(i < _size)
-                return (i + _head) % _capacity;
+                return wrap(i + _head);
             else
                 throw std::out_of_range("Index out of range");
         }   
@@ -545,10 +1723,81 @@ class cbuffer {
 
 
         
-template <typename T>
-std::ostream& operator<<(std::ostream &os, const cbuffer<T> & cb) {
-	for (typename cbuffer<T>::size_type i = 0; i < cb.size(); ++i)
+template <typename T, std::size_t N, typename A, int S>
+std::ostream& operator<<(std::ostream &os, const cbuffer<T, N, A, S> & cb) {
+	for (typename cbuffer<T, N, A, S>::size_type i = 0; i < cb.size(); ++i)
 		os << cb[i] << " ";
 	return os;
 }
+/**
+ * @brief Applicazione di un funtore a tutti gli elementi
+ * 
+ * Equivalente a std::for_each(cb.begin(), cb.end(), f), ma eseguito come due cicli
+ * lineari sui blocchi contigui array_one() e array_two(), che il compilatore può vettorizzare.
+ * @param cb buffer circolare
+ * @param f funtore unario
+ * @return Il funtore dopo l'applicazione
+**/
+template <typename T, std::size_t N, typename A, int S, typename F>
+F for_each(cbuffer<T, N, A, S> &cb, F f) {
+	const typename cbuffer<T, N, A, S>::array_range one = cb.array_one();
+	const typename cbuffer<T, N, A, S>::array_range two = cb.array_two();
+	return std::for_each(two.first, two.first + two.second,
+	                     std::for_each(one.first, one.first + one.second, std::move(f)));
+}
+
+/**
+ * @brief Applicazione di un funtore a tutti gli elementi in sola lettura
+ * 
+ * @param cb buffer circolare
+ * @param f funtore unario
+ * @return Il funtore dopo l'applicazione
+**/
+template <typename T, std::size_t N, typename A, int S, typename F>
+F for_each(const cbuffer<T, N, A, S> &cb, F f) {
+	const typename cbuffer<T, N, A, S>::const_array_range one = cb.array_one();
+	const typename cbuffer<T, N, A, S>::const_array_range two = cb.array_two();
+	return std::for_each(two.first, two.first + two.second,
+	                     std::for_each(one.first, one.first + one.second, std::move(f)));
+}
+
+/**
+ * @brief Accumulazione degli elementi
+ * 
+ * Equivalente a std::accumulate(cb.begin(), cb.end(), init, op), eseguito come due cicli
+ * lineari sui blocchi contigui del buffer.
+ * @param cb buffer circolare
+ * @param init valore iniziale
+ * @param op operazione binaria
+ * @return Il valore accumulato
+**/
+template <typename T, std::size_t N, typename A, int S, typename Acc, typename BinaryOp>
+Acc accumulate(const cbuffer<T, N, A, S> &cb, Acc init, BinaryOp op) {
+	const typename cbuffer<T, N, A, S>::const_array_range one = cb.array_one();
+	const typename cbuffer<T, N, A, S>::const_array_range two = cb.array_two();
+	init = std::accumulate(one.first, one.first + one.second, init, op);
+	return std::accumulate(two.first, two.first + two.second, init, op);
+}
+
+/**
+ * @brief Somma degli elementi
+ * 
+ * @param cb buffer circolare
+ * @param init valore iniziale
+ * @return init più la somma degli elementi
+**/
+template <typename T, std::size_t N, typename A, int S, typename Acc>
+Acc accumulate(const cbuffer<T, N, A, S> &cb, Acc init) {
+	return accumulate(cb, init, std::plus<Acc>());
+}
+namespace pmr {
+    /**
+     * @brief cbuffer con memoria polimorfica
+     * 
+     * cbuffer a capacità dinamica che ottiene la memoria da una std::pmr::memory_resource
+     * (ad esempio un'arena, o hugepage_resource).
+    **/
+    template <class T>
+    using cbuffer = ::cbuffer<T, 0, std::pmr::polymorphic_allocator<T> >;
+}
 #endif
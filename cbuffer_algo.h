@@ -0,0 +1,376 @@
+#ifndef CBUFFER_ALGO_H
+#define CBUFFER_ALGO_H
+
+#include <cstddef>     // std::size_t
+#include <cstdint>     // std::uint32_t, std::uint64_t
+#include <type_traits>
+#include <vector>
+#include "cbuffer.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define CBUFFER_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+/**
+ * @file cbuffer_algo.h
+ * @brief Algoritmi di valutazione di predicati sugli elementi di un cbuffer
+ *
+ * count_if, find_if, all_of, any_of, none_of ed evaluate_mask lavorano sui due blocchi
+ * contigui del buffer (array_one e array_two) invece che per indice. Con i predicati di
+ * confronto threshold<int, ...> e threshold<float, ...> il confronto è vettoriale: AVX2 se il
+ * processore lo supporta (scelto a runtime), altrimenti SSE2, altrimenti scalare.
+ * Con gli altri predicati il ciclo è scalare e senza salti, e il compilatore può vettorizzarlo.
+**/
+
+/**
+ * @brief Operatore di confronto di un predicato threshold
+**/
+enum class cmp_op {
+    lt, // minore
+    le, // minore o uguale
+    gt, // maggiore
+    ge, // maggiore o uguale
+    eq, // uguale
+    ne  // diverso
+};
+
+/**
+ * @brief Predicato di confronto con una soglia
+ *
+ * Torna true se value Op bound. Si può usare direttamente o come classe base di un
+ * predicato con soglia fissa, ad esempio positive_int; per T = int e T = float gli
+ * algoritmi di questo file ne riconoscono la forma e usano le istruzioni SIMD.
+**/
+template <class T, cmp_op Op>
+struct threshold {
+    typedef T threshold_type;
+    static const cmp_op op = Op;
+
+    T bound;
+
+    bool operator()(const T &value) const {
+        switch(Op) {
+            case cmp_op::lt: return value < bound;
+            case cmp_op::le: return value <= bound;
+            case cmp_op::gt: return value > bound;
+            case cmp_op::ge: return value >= bound;
+            case cmp_op::eq: return value == bound;
+            default:         return value != bound;
+        }
+    }
+};
+
+namespace cbuffer_simd {
+
+/**
+ * Riconosce i predicati derivati da threshold<T, Op> con un tipo T supportato dai kernel SIMD.
+**/
+template <class T, class P, class = void>
+struct is_simd_threshold : std::false_type {
+};
+
+template <class T, class P>
+struct is_simd_threshold<T, P, typename std::enable_if<
+        std::is_base_of<threshold<typename P::threshold_type, P::op>, P>::value>::type>
+    : std::integral_constant<bool, std::is_same<typename P::threshold_type, T>::value &&
+                                   (std::is_same<T, int>::value || std::is_same<T, float>::value) &&
+                                   sizeof(T) == 4> {
+};
+
+/**
+ * @brief Visitatori dei blocchi di risultati
+ *
+ * Ricevono, per ogni gruppo di al più 32 elementi consecutivi, l'indice logico del primo
+ * elemento, i bit dei risultati del predicato (bit i = elemento index + i) e il numero di
+ * elementi del gruppo. Tornano false per interrompere la scansione.
+**/
+struct count_visitor {
+    std::size_t count;
+
+    bool operator()(std::size_t, std::uint32_t bits, unsigned int) {
+        count += __builtin_popcount(bits);
+        return true;
+    }
+};
+
+struct find_visitor {
+    std::size_t found;
+    bool negate;  // cerca il primo elemento che NON soddisfa il predicato (all_of)
+
+    bool operator()(std::size_t index, std::uint32_t bits, unsigned int lanes) {
+        if(negate)
+            bits = ~bits & (lanes == 32 ? 0xffffffffu : (1u << lanes) - 1);
+        if(bits == 0)
+            return true;
+        found = index + __builtin_ctz(bits);
+        return false;
+    }
+};
+
+struct mask_visitor {
+    std::uint64_t *mask;
+
+    bool operator()(std::size_t index, std::uint32_t bits, unsigned int lanes) {
+        const std::size_t word = index / 64, shift = index % 64;
+        mask[word] |= std::uint64_t(bits) << shift;
+        if(shift + lanes > 64)
+            mask[word + 1] |= std::uint64_t(bits) >> (64 - shift);
+        return true;
+    }
+};
+
+//Bit dei risultati di un gruppo di al più 32 elementi, senza SIMD
+template <class T, class P>
+inline std::uint32_t scalar_bits(const T *p, unsigned int n, P &pred) {
+    std::uint32_t bits = 0;
+    for(unsigned int i = 0; i < n; i++)
+        bits |= std::uint32_t(pred(p[i]) ? 1 : 0) << i;
+    return bits;
+}
+
+/**
+ * @brief Scansione scalare di un blocco contiguo
+ *
+ * @param p Primo elemento del blocco
+ * @param n Numero di elementi
+ * @param base Indice logico del primo elemento
+ * @return false se il visitatore ha interrotto la scansione
+**/
+template <class T, class P, class V>
+inline bool scan_scalar(const T *p, std::size_t n, std::size_t base, P &pred, V &visit) {
+    for(std::size_t i = 0; i < n; i += 32) {
+        const unsigned int lanes = (n - i < 32) ? unsigned(n - i) : 32;
+        if(!visit(base + i, scalar_bits(p + i, lanes, pred), lanes))
+            return false;
+    }
+    return true;
+}
+
+#ifdef CBUFFER_SIMD_X86
+
+//Confronto di 4 interi con la soglia (SSE2); ritorna 4 bit
+template <cmp_op Op>
+inline unsigned int sse2_bits(const int *p, __m128i bound) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i r;
+    switch(Op) {
+        case cmp_op::lt: case cmp_op::ge: r = _mm_cmplt_epi32(v, bound); break;
+        case cmp_op::gt: case cmp_op::le: r = _mm_cmpgt_epi32(v, bound); break;
+        default:                          r = _mm_cmpeq_epi32(v, bound); break;
+    }
+    const unsigned int bits = _mm_movemask_ps(_mm_castsi128_ps(r));
+    return (Op == cmp_op::ge || Op == cmp_op::le || Op == cmp_op::ne) ? bits ^ 0xf : bits;
+}
+
+//Confronto di 4 float con la soglia (SSE2); ritorna 4 bit
+template <cmp_op Op>
+inline unsigned int sse2_bits(const float *p, __m128 bound) {
+    const __m128 v = _mm_loadu_ps(p);
+    __m128 r;
+    switch(Op) {
+        case cmp_op::lt: r = _mm_cmplt_ps(v, bound); break;
+        case cmp_op::le: r = _mm_cmple_ps(v, bound); break;
+        case cmp_op::gt: r = _mm_cmpgt_ps(v, bound); break;
+        case cmp_op::ge: r = _mm_cmpge_ps(v, bound); break;
+        case cmp_op::eq: r = _mm_cmpeq_ps(v, bound); break;
+        default:         r = _mm_cmpneq_ps(v, bound); break;
+    }
+    return _mm_movemask_ps(r);
+}
+
+inline __m128i sse2_splat(int x) {
+    return _mm_set1_epi32(x);
+}
+
+inline __m128 sse2_splat(float x) {
+    return _mm_set1_ps(x);
+}
+
+//Scansione di un blocco contiguo a gruppi di 32 elementi, 4 per confronto
+template <class T, class P, class V>
+inline bool scan_sse2(const T *p, std::size_t n, std::size_t base, P &pred, V &visit) {
+    const auto bound = sse2_splat(pred.bound);
+    std::size_t i = 0;
+    for(; i + 32 <= n; i += 32) {
+        std::uint32_t bits = 0;
+        for(unsigned int j = 0; j < 32; j += 4)
+            bits |= std::uint32_t(sse2_bits<P::op>(p + i + j, bound)) << j;
+        if(!visit(base + i, bits, 32))
+            return false;
+    }
+    return scan_scalar(p + i, n - i, base + i, pred, visit);
+}
+
+//Confronto di 8 interi con la soglia (AVX2); ritorna 8 bit
+template <cmp_op Op>
+__attribute__((target("avx2"))) inline unsigned int avx2_bits(const int *p, __m256i bound) {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i r;
+    switch(Op) {
+        case cmp_op::lt: case cmp_op::ge: r = _mm256_cmpgt_epi32(bound, v); break;
+        case cmp_op::gt: case cmp_op::le: r = _mm256_cmpgt_epi32(v, bound); break;
+        default:                          r = _mm256_cmpeq_epi32(v, bound); break;
+    }
+    const unsigned int bits = _mm256_movemask_ps(_mm256_castsi256_ps(r));
+    return (Op == cmp_op::ge || Op == cmp_op::le || Op == cmp_op::ne) ? bits ^ 0xff : bits;
+}
+
+//Confronto di 8 float con la soglia (AVX2); ritorna 8 bit
+template <cmp_op Op>
+__attribute__((target("avx2"))) inline unsigned int avx2_bits(const float *p, __m256 bound) {
+    const __m256 v = _mm256_loadu_ps(p);
+    __m256 r;
+    switch(Op) {
+        case cmp_op::lt: r = _mm256_cmp_ps(v, bound, _CMP_LT_OQ); break;
+        case cmp_op::le: r = _mm256_cmp_ps(v, bound, _CMP_LE_OQ); break;
+        case cmp_op::gt: r = _mm256_cmp_ps(v, bound, _CMP_GT_OQ); break;
+        case cmp_op::ge: r = _mm256_cmp_ps(v, bound, _CMP_GE_OQ); break;
+        case cmp_op::eq: r = _mm256_cmp_ps(v, bound, _CMP_EQ_OQ); break;
+        default:         r = _mm256_cmp_ps(v, bound, _CMP_NEQ_UQ); break;
+    }
+    return _mm256_movemask_ps(r);
+}
+
+__attribute__((target("avx2"))) inline __m256i avx2_splat(int x) {
+    return _mm256_set1_epi32(x);
+}
+
+__attribute__((target("avx2"))) inline __m256 avx2_splat(float x) {
+    return _mm256_set1_ps(x);
+}
+
+//Scansione di un blocco contiguo a gruppi di 32 elementi, 8 per confronto
+template <class T, class P, class V>
+__attribute__((target("avx2")))
+bool scan_avx2(const T *p, std::size_t n, std::size_t base, P &pred, V &visit) {
+    const auto bound = avx2_splat(pred.bound);
+    std::size_t i = 0;
+    for(; i + 32 <= n; i += 32) {
+        const std::uint32_t bits = avx2_bits<P::op>(p + i, bound) |
+                                   avx2_bits<P::op>(p + i + 8, bound) << 8 |
+                                   avx2_bits<P::op>(p + i + 16, bound) << 16 |
+                                   std::uint32_t(avx2_bits<P::op>(p + i + 24, bound)) << 24;
+        if(!visit(base + i, bits, 32))
+            return false;
+    }
+    return scan_scalar(p + i, n - i, base + i, pred, visit);
+}
+
+//true se il processore supporta AVX2 (verificato una sola volta)
+inline bool has_avx2() {
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+#endif
+
+/**
+ * @brief Scansione di un blocco contiguo con il kernel migliore disponibile
+**/
+template <class T, class P, class V>
+inline bool scan(const T *p, std::size_t n, std::size_t base, P &pred, V &visit) {
+#ifdef CBUFFER_SIMD_X86
+    if constexpr(is_simd_threshold<T, P>::value) {
+        if(has_avx2())
+            return scan_avx2(p, n, base, pred, visit);
+        return scan_sse2(p, n, base, pred, visit);
+    }
+#endif
+    return scan_scalar(p, n, base, pred, visit);
+}
+
+/**
+ * @brief Scansione dei due blocchi contigui di un cbuffer
+**/
+template <class T, std::size_t N, class A, int S, class P, class V>
+inline void scan(const cbuffer<T, N, A, S> &cb, P &pred, V &visit) {
+    const typename cbuffer<T, N, A, S>::const_array_range one = cb.array_one();
+    const typename cbuffer<T, N, A, S>::const_array_range two = cb.array_two();
+    if(scan(one.first, one.second, 0, pred, visit))
+        scan(two.first, two.second, one.second, pred, visit);
+}
+
+}
+
+/**
+ * @brief Conteggio degli elementi che soddisfano un predicato
+ *
+ * Equivalente a std::count_if(cb.begin(), cb.end(), pred).
+ * @param cb buffer circolare
+ * @param pred predicato unario
+ * @return Il numero di elementi per cui pred è vero
+**/
+template <typename T, std::size_t N, typename A, int S, typename P>
+typename cbuffer<T, N, A, S>::size_type count_if(const cbuffer<T, N, A, S> &cb, P pred) {
+    cbuffer_simd::count_visitor visit = {0};
+    cbuffer_simd::scan(cb, pred, visit);
+    return static_cast<typename cbuffer<T, N, A, S>::size_type>(visit.count);
+}
+
+/**
+ * @brief Ricerca del primo elemento che soddisfa un predicato
+ *
+ * @param cb buffer circolare
+ * @param pred predicato unario
+ * @return L'indice logico del primo elemento per cui pred è vero, cb.size() se nessuno
+**/
+template <typename T, std::size_t N, typename A, int S, typename P>
+typename cbuffer<T, N, A, S>::size_type find_if(const cbuffer<T, N, A, S> &cb, P pred) {
+    cbuffer_simd::find_visitor visit = {cb.size(), false};
+    cbuffer_simd::scan(cb, pred, visit);
+    return static_cast<typename cbuffer<T, N, A, S>::size_type>(visit.found);
+}
+
+/**
+ * @brief Verifica che tutti gli elementi soddisfino un predicato
+ *
+ * La scansione si ferma al primo gruppo con un elemento che non lo soddisfa.
+ * @return true se pred è vero per tutti gli elementi (o il buffer è vuoto)
+**/
+template <typename T, std::size_t N, typename A, int S, typename P>
+bool all_of(const cbuffer<T, N, A, S> &cb, P pred) {
+    cbuffer_simd::find_visitor visit = {cb.size(), true};
+    cbuffer_simd::scan(cb, pred, visit);
+    return visit.found == cb.size();
+}
+
+/**
+ * @brief Verifica che almeno un elemento soddisfi un predicato
+ *
+ * @return true se pred è vero per almeno un elemento
+**/
+template <typename T, std::size_t N, typename A, int S, typename P>
+bool any_of(const cbuffer<T, N, A, S> &cb, P pred) {
+    return find_if(cb, pred) != cb.size();
+}
+
+/**
+ * @brief Verifica che nessun elemento soddisfi un predicato
+ *
+ * @return true se pred è falso per tutti gli elementi (o il buffer è vuoto)
+**/
+template <typename T, std::size_t N, typename A, int S, typename P>
+bool none_of(const cbuffer<T, N, A, S> &cb, P pred) {
+    return !any_of(cb, pred);
+}
+
+/**
+ * @brief Valutazione di un predicato su tutti gli elementi
+ *
+ * Il risultato è una maschera di bit compatta: il bit i % 64 della parola i / 64
+ * vale pred(cb[i]). I bit oltre cb.size() sono a zero.
+ * @param cb buffer circolare
+ * @param pred predicato unario
+ * @return Le (cb.size() + 63) / 64 parole della maschera
+**/
+template <typename T, std::size_t N, typename A, int S, typename P>
+std::vector<std::uint64_t> evaluate_mask(const cbuffer<T, N, A, S> &cb, P pred) {
+    std::vector<std::uint64_t> mask((cb.size() + 63) / 64 + 1, 0);
+    cbuffer_simd::mask_visitor visit = {mask.data()};
+    cbuffer_simd::scan(cb, pred, visit);
+    mask.pop_back();
+    return mask;
+}
+
+#endif
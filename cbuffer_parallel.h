@@ -0,0 +1,370 @@
+#ifndef CBUFFER_PARALLEL_H
+#define CBUFFER_PARALLEL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>     // std::size_t
+#include <exception>   // std::exception_ptr
+#include <functional>  // std::function
+#include <mutex>
+#include <thread>
+#include <utility>     // std::pair
+#include <vector>
+#include "cbuffer.h"
+#include "cbuffer_algo.h"
+
+/**
+ * @file cbuffer_parallel.h
+ * @brief Algoritmi paralleli sugli elementi di un cbuffer
+ *
+ * parallel_for_each, parallel_transform, parallel_reduce e parallel_count_if dividono gli
+ * elementi presenti in un blocco per thread. Ogni blocco è formato da al più due tratti
+ * contigui di memoria (solo quello che contiene il punto di giro ne ha due), scanditi con
+ * puntatori come for_each e accumulate di cbuffer.h. I thread sono quelli di un piccolo
+ * pool interno, cbuffer_thread_pool; il thread chiamante partecipa al lavoro.
+**/
+
+/**
+ * @brief Pool di thread per gli algoritmi paralleli
+ *
+ * Esegue gruppi di attività numerate 0..tasks-1 e attende che siano terminate tutte
+ * (fork-join). Le esecuzioni concorrenti di run() vengono serializzate.
+**/
+class cbuffer_thread_pool {
+    public:
+        typedef std::function<void(unsigned int)> task_type;
+
+        /**
+         * @brief Costruttore secondario
+         *
+         * @param threads Numero di thread che eseguono le attività, compreso il chiamante
+        **/
+        explicit cbuffer_thread_pool(unsigned int threads = std::thread::hardware_concurrency())
+                : _task(0), _tasks(0), _next(0), _finished(0), _active(0), _generation(0), _stop(false) {
+            for(unsigned int i = 1; i < threads; i++)
+                _workers.push_back(std::thread(&cbuffer_thread_pool::work, this));
+        }
+
+        /**
+         * @brief Distruttore
+         *
+         * Ferma e attende i thread del pool.
+        **/
+        ~cbuffer_thread_pool() {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+            _start.notify_all();
+            for(std::thread &t : _workers)
+                t.join();
+        }
+
+        /**
+         * @brief Numero di thread
+         *
+         * @return Il numero di thread che eseguono le attività, compreso il chiamante
+        **/
+        unsigned int size() const {
+            return static_cast<unsigned int>(_workers.size()) + 1;
+        }
+
+        /**
+         * @brief Esecuzione di un gruppo di attività
+         *
+         * Chiama task(i) per ogni i in [0, tasks), in parallelo, e ritorna quando sono
+         * terminate tutte.
+         * @param tasks Numero di attività
+         * @param task Funzione che esegue l'attività i-esima
+         * @throw La prima eccezione lanciata da un'attività, dopo che le altre sono terminate
+        **/
+        void run(unsigned int tasks, const task_type &task) {
+            if(tasks == 0)
+                return;
+            std::lock_guard<std::mutex> serialize(_run_mutex);
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _task = &task;
+                _tasks = tasks;
+                _next.store(0, std::memory_order_relaxed);
+                _finished = 0;
+                _error = std::exception_ptr();
+                _generation++;
+            }
+            if(tasks > 1)
+                _start.notify_all();
+
+            execute(task, tasks);
+
+            std::unique_lock<std::mutex> lock(_mutex);
+            while(_finished != _tasks || _active != 0)
+                _done.wait(lock);
+            _task = 0;
+            if(_error)
+                std::rethrow_exception(_error);
+        }
+
+    private:
+        //Non copiabile: possiede i thread
+        cbuffer_thread_pool(const cbuffer_thread_pool &other);
+        cbuffer_thread_pool &operator=(const cbuffer_thread_pool &other);
+
+        std::vector<std::thread> _workers;
+        std::mutex _run_mutex;
+        std::mutex _mutex;
+        std::condition_variable _start;
+        std::condition_variable _done;
+
+        const task_type *_task;
+        unsigned int _tasks;
+        std::atomic<unsigned int> _next;  // prossima attività da assegnare
+        unsigned int _finished;           // attività terminate
+        unsigned int _active;             // thread del pool dentro execute()
+        unsigned long _generation;        // numero del gruppo corrente
+        bool _stop;
+        std::exception_ptr _error;
+
+        //Ciclo dei thread del pool: attende un nuovo gruppo e partecipa
+        void work() {
+            unsigned long seen = 0;
+            std::unique_lock<std::mutex> lock(_mutex);
+            for(;;) {
+                while(!_stop && (_generation == seen || _task == 0))
+                    _start.wait(lock);
+                if(_stop)
+                    return;
+                seen = _generation;
+                const task_type *task = _task;
+                const unsigned int tasks = _tasks;
+                _active++;
+                lock.unlock();
+                execute(*task, tasks);
+                lock.lock();
+                _active--;
+                if(_active == 0 && _finished == _tasks)
+                    _done.notify_all();
+            }
+        }
+
+        //Esegue attività finché ce ne sono da assegnare
+        void execute(const task_type &task, unsigned int tasks) {
+            unsigned int done = 0;
+            std::exception_ptr error;
+            for(unsigned int i = _next.fetch_add(1, std::memory_order_relaxed); i < tasks;
+                i = _next.fetch_add(1, std::memory_order_relaxed)) {
+                try {
+                    task(i);
+                }
+                catch(...) {
+                    if(!error)
+                        error = std::current_exception();
+                }
+                done++;
+            }
+            if(done == 0)
+                return;
+            std::lock_guard<std::mutex> lock(_mutex);
+            if(error && !_error)
+                _error = error;
+            _finished += done;
+            if(_finished == _tasks)
+                _done.notify_all();
+        }
+};
+
+namespace cbuffer_parallel {
+
+/**
+ * Numero minimo di elementi per blocco: sotto questa soglia il costo di svegliare
+ * un thread supera quello della scansione.
+**/
+const std::size_t min_chunk = 16384;
+
+/**
+ * @brief Pool condiviso
+ *
+ * Pool usato dagli algoritmi chiamati senza un pool esplicito, con un thread per processore.
+**/
+inline cbuffer_thread_pool &default_pool() {
+    static cbuffer_thread_pool pool;
+    return pool;
+}
+
+//Numero di blocchi in cui dividere n elementi
+inline unsigned int chunks(const cbuffer_thread_pool &pool, std::size_t n) {
+    const std::size_t by_size = (n + min_chunk - 1) / min_chunk;
+    return static_cast<unsigned int>(by_size < pool.size() ? by_size : pool.size());
+}
+
+/**
+ * @brief Tratti contigui di un blocco
+ *
+ * Il blocco k di tasks copre gli indici logici [n * k / tasks, n * (k + 1) / tasks) ed è
+ * formato da un tratto di array_one e uno di array_two (eventualmente vuoti).
+**/
+template <class P>
+struct chunk {
+    P first;          // primo tratto
+    std::size_t first_size;
+    P second;         // secondo tratto
+    std::size_t second_size;
+    std::size_t begin; // indice logico del primo elemento
+};
+
+template <class P, class S>
+inline chunk<P> make_chunk(const std::pair<P, S> &one, const std::pair<P, S> &two,
+                           unsigned int k, unsigned int tasks) {
+    const std::size_t n = std::size_t(one.second) + two.second;
+    const std::size_t b = n * k / tasks, e = n * (k + 1) / tasks;
+    const std::size_t len = one.second;
+    chunk<P> c;
+    c.begin = b;
+    c.first = one.first + (b < len ? b : len);
+    c.first_size = (b < len) ? ((e < len ? e : len) - b) : 0;
+    c.second = two.first + (b > len ? b - len : 0);
+    c.second_size = (e > len) ? e - (b > len ? b : len) : 0;
+    return c;
+}
+
+}
+
+/**
+ * @brief for_each parallelo
+ *
+ * Applica f a ogni elemento, da più thread contemporaneamente: f deve poter essere
+ * chiamata in modo concorrente su elementi diversi. L'ordine non è definito.
+ * @param pool pool di thread
+ * @param cb buffer circolare
+ * @param f funzione unaria
+**/
+template <typename T, std::size_t N, typename A, int S, typename F>
+void parallel_for_each(cbuffer_thread_pool &pool, cbuffer<T, N, A, S> &cb, F f) {
+    const typename cbuffer<T, N, A, S>::array_range one = cb.array_one(), two = cb.array_two();
+    const unsigned int tasks = cbuffer_parallel::chunks(pool, cb.size());
+    pool.run(tasks, [&](unsigned int k) {
+        const cbuffer_parallel::chunk<T*> c = cbuffer_parallel::make_chunk(one, two, k, tasks);
+        for(T *p = c.first, *e = c.first + c.first_size; p != e; ++p)
+            f(*p);
+        for(T *p = c.second, *e = c.second + c.second_size; p != e; ++p)
+            f(*p);
+    });
+}
+
+template <typename T, std::size_t N, typename A, int S, typename F>
+void parallel_for_each(cbuffer<T, N, A, S> &cb, F f) {
+    parallel_for_each(cbuffer_parallel::default_pool(), cb, f);
+}
+
+/**
+ * @brief transform parallelo
+ *
+ * Scrive out[i] = f(cb[i]) per ogni indice logico i, da più thread contemporaneamente.
+ * @param pool pool di thread
+ * @param cb buffer circolare
+ * @param out iteratore ad accesso casuale di inizio della destinazione (cb.size() elementi)
+ * @param f funzione unaria
+ * @return L'iteratore successivo all'ultimo elemento scritto
+**/
+template <typename T, std::size_t N, typename A, int S, typename RandomIt, typename F>
+RandomIt parallel_transform(cbuffer_thread_pool &pool, const cbuffer<T, N, A, S> &cb, RandomIt out, F f) {
+    const typename cbuffer<T, N, A, S>::const_array_range one = cb.array_one(), two = cb.array_two();
+    const unsigned int tasks = cbuffer_parallel::chunks(pool, cb.size());
+    pool.run(tasks, [&](unsigned int k) {
+        const cbuffer_parallel::chunk<const T*> c = cbuffer_parallel::make_chunk(one, two, k, tasks);
+        RandomIt o = out + c.begin;
+        for(const T *p = c.first, *e = c.first + c.first_size; p != e; ++p, ++o)
+            *o = f(*p);
+        for(const T *p = c.second, *e = c.second + c.second_size; p != e; ++p, ++o)
+            *o = f(*p);
+    });
+    return out + cb.size();
+}
+
+template <typename T, std::size_t N, typename A, int S, typename RandomIt, typename F>
+RandomIt parallel_transform(const cbuffer<T, N, A, S> &cb, RandomIt out, F f) {
+    return parallel_transform(cbuffer_parallel::default_pool(), cb, out, f);
+}
+
+/**
+ * @brief Riduzione parallela
+ *
+ * Ogni thread riduce il proprio blocco; i risultati parziali vengono poi combinati
+ * nell'ordine dei blocchi, quindi op deve essere associativa; non è richiesta la commutatività.
+ * @param pool pool di thread
+ * @param cb buffer circolare
+ * @param init valore iniziale
+ * @param op operazione binaria associativa
+ * @return op(init, op(cb[0], op(cb[1], ...)))
+**/
+template <typename T, std::size_t N, typename A, int S, typename Acc, typename BinaryOp>
+Acc parallel_reduce(cbuffer_thread_pool &pool, const cbuffer<T, N, A, S> &cb, Acc init, BinaryOp op) {
+    const typename cbuffer<T, N, A, S>::const_array_range one = cb.array_one(), two = cb.array_two();
+    const unsigned int tasks = cbuffer_parallel::chunks(pool, cb.size());
+    std::vector<Acc> partial(tasks, init);
+    std::vector<char> used(tasks, 0);
+    pool.run(tasks, [&](unsigned int k) {
+        const cbuffer_parallel::chunk<const T*> c = cbuffer_parallel::make_chunk(one, two, k, tasks);
+        const T *p1 = c.first, *e1 = c.first + c.first_size;
+        const T *p2 = c.second, *e2 = c.second + c.second_size;
+        if(p1 == e1) {
+            if(p2 == e2)
+                return;
+            std::swap(p1, p2);
+            std::swap(e1, e2);
+        }
+        Acc acc = *p1++;
+        for(; p1 != e1; ++p1)
+            acc = op(acc, *p1);
+        for(; p2 != e2; ++p2)
+            acc = op(acc, *p2);
+        partial[k] = acc;
+        used[k] = 1;
+    });
+    for(unsigned int k = 0; k < tasks; k++)
+        if(used[k])
+            init = op(init, partial[k]);
+    return init;
+}
+
+template <typename T, std::size_t N, typename A, int S, typename Acc, typename BinaryOp>
+Acc parallel_reduce(const cbuffer<T, N, A, S> &cb, Acc init, BinaryOp op) {
+    return parallel_reduce(cbuffer_parallel::default_pool(), cb, init, op);
+}
+
+template <typename T, std::size_t N, typename A, int S, typename Acc>
+Acc parallel_reduce(const cbuffer<T, N, A, S> &cb, Acc init) {
+    return parallel_reduce(cbuffer_parallel::default_pool(), cb, init, std::plus<Acc>());
+}
+
+/**
+ * @brief count_if parallelo
+ *
+ * Ogni thread conta il proprio blocco con lo stesso kernel di count_if (SIMD per i
+ * predicati threshold).
+ * @param pool pool di thread
+ * @param cb buffer circolare
+ * @param pred predicato unario
+ * @return Il numero di elementi per cui pred è vero
+**/
+template <typename T, std::size_t N, typename A, int S, typename P>
+typename cbuffer<T, N, A, S>::size_type parallel_count_if(cbuffer_thread_pool &pool, const cbuffer<T, N, A, S> &cb, P pred) {
+    const typename cbuffer<T, N, A, S>::const_array_range one = cb.array_one(), two = cb.array_two();
+    const unsigned int tasks = cbuffer_parallel::chunks(pool, cb.size());
+    std::atomic<std::size_t> total(0);
+    pool.run(tasks, [&](unsigned int k) {
+        const cbuffer_parallel::chunk<const T*> c = cbuffer_parallel::make_chunk(one, two, k, tasks);
+        P local(pred);
+        cbuffer_simd::count_visitor visit = {0};
+        cbuffer_simd::scan(c.first, c.first_size, 0, local, visit);
+        cbuffer_simd::scan(c.second, c.second_size, 0, local, visit);
+        total.fetch_add(visit.count, std::memory_order_relaxed);
+    });
+    return static_cast<typename cbuffer<T, N, A, S>::size_type>(total.load());
+}
+
+template <typename T, std::size_t N, typename A, int S, typename P>
+typename cbuffer<T, N, A, S>::size_type parallel_count_if(const cbuffer<T, N, A, S> &cb, P pred) {
+    return parallel_count_if(cbuffer_parallel::default_pool(), cb, pred);
+}
+
+#endif
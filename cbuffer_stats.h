@@ -0,0 +1,186 @@
+#ifndef CBUFFER_STATS_H
+#define CBUFFER_STATS_H
+
+#include <algorithm> // std::fill
+#include <chrono>
+#include <cstdint>  // std::uint64_t
+#include <utility>  // std::swap
+#include <vector>
+
+/**
+ * @file cbuffer_stats.h
+ * @brief Contatori di occupazione e latenza di cbuffer
+ *
+ * Il livello di strumentazione è il parametro Stats di cbuffer<T, N, Alloc, Stats>:
+ *  0 nessun contatore: le chiamate sono funzioni vuote e l'oggetto non occupa spazio;
+ *  1 inserimenti, rimozioni, sovrascritture, massimo riempimento e istogramma dell'occupazione;
+ *  2 come 1, più la latenza di permanenza (dall'inserimento alla rimozione), misurata su un
+ *    inserimento ogni CBUFFER_STATS_SAMPLE tramite un timestamp per slot.
+ * CBUFFER_STATS fissa solo il valore di default del parametro. Poiché il livello fa parte del
+ * tipo, unità di compilazione compilate con valori diversi usano tipi diversi: scambiarsi un
+ * cbuffer<T> tra di esse produce un errore di collegamento invece di un oggetto incoerente.
+**/
+
+#ifndef CBUFFER_STATS
+#define CBUFFER_STATS 0
+#endif
+
+#if CBUFFER_STATS < 0 || CBUFFER_STATS > 2
+#error "CBUFFER_STATS deve valere 0, 1 o 2"
+#endif
+
+#ifndef CBUFFER_STATS_SAMPLE
+#define CBUFFER_STATS_SAMPLE 64
+#endif
+
+/**
+ * @brief Fotografia dei contatori di un cbuffer
+ *
+ * Con il livello 0 tutti i campi valgono zero.
+**/
+struct cbuffer_stats {
+    static const unsigned int buckets = 16;
+
+    unsigned long inserts;          // elementi inseriti
+    unsigned long removes;          // elementi rimossi dal consumatore
+    unsigned long overwrites;       // elementi scartati per far posto ai nuovi
+    unsigned int high_watermark;    // massimo numero di elementi presenti
+    unsigned long occupancy[buckets]; // inserimenti per fascia di riempimento (i / buckets della capacità)
+
+    unsigned long residency_samples;  // rimozioni con latenza misurata
+    std::uint64_t residency_total_ns;
+    std::uint64_t residency_max_ns;
+
+    /**
+     * @brief Latenza media di permanenza
+     *
+     * @return La media in nanosecondi, 0 se non ci sono campioni
+    **/
+    double residency_mean_ns() const {
+        return residency_samples ? double(residency_total_ns) / residency_samples : 0;
+    }
+};
+
+/**
+ * @brief Contatori interni di un cbuffer
+ *
+ * Specializzati per livello; cbuffer chiama gli stessi metodi a ogni livello.
+ * slot è l'indice fisico dell'elemento, size il numero di elementi dopo l'operazione.
+**/
+template <int Level>
+class cbuffer_counters {
+    public:
+        void resize(unsigned int) {}
+        void relocated() {}
+        void inserted(unsigned int, unsigned int, unsigned int) {}
+        void evicted(unsigned int) {}
+        void removed(unsigned int) {}
+        void reset() {}
+        void swap(cbuffer_counters &) {}
+
+        cbuffer_stats snapshot() const {
+            return cbuffer_stats();
+        }
+};
+
+template <>
+class cbuffer_counters<1> {
+    public:
+        cbuffer_counters() : _stats() {
+        }
+
+        void resize(unsigned int) {
+        }
+
+        void relocated() {
+        }
+
+        void inserted(unsigned int, unsigned int size, unsigned int capacity) {
+            _stats.inserts++;
+            if(size > _stats.high_watermark)
+                _stats.high_watermark = size;
+            const unsigned long bucket = (unsigned long)size * cbuffer_stats::buckets / capacity;
+            _stats.occupancy[bucket < cbuffer_stats::buckets ? bucket : cbuffer_stats::buckets - 1]++;
+        }
+
+        void evicted(unsigned int n) {
+            _stats.overwrites += n;
+        }
+
+        void removed(unsigned int) {
+            _stats.removes++;
+        }
+
+        void reset() {
+            _stats = cbuffer_stats();
+        }
+
+        void swap(cbuffer_counters &other) {
+            std::swap(_stats, other._stats);
+        }
+
+        cbuffer_stats snapshot() const {
+            return _stats;
+        }
+
+    protected:
+        cbuffer_stats _stats;
+};
+
+template <>
+class cbuffer_counters<2> : public cbuffer_counters<1> {
+    public:
+        cbuffer_counters() : _timestamps(), _sample(0) {
+        }
+
+        //Un timestamp per slot; 0 indica un elemento non campionato
+        void resize(unsigned int capacity) {
+            _timestamps.assign(capacity, 0);
+        }
+
+        //Gli elementi hanno cambiato slot: i timestamp non sono più validi
+        void relocated() {
+            std::fill(_timestamps.begin(), _timestamps.end(), 0);
+        }
+
+        void inserted(unsigned int slot, unsigned int size, unsigned int capacity) {
+            cbuffer_counters<1>::inserted(slot, size, capacity);
+            if(slot >= _timestamps.size())
+                return;
+            if(++_sample == CBUFFER_STATS_SAMPLE) {
+                _sample = 0;
+                _timestamps[slot] = now();
+            }
+            else
+                _timestamps[slot] = 0;
+        }
+
+        void removed(unsigned int slot) {
+            cbuffer_counters<1>::removed(slot);
+            if(slot >= _timestamps.size() || _timestamps[slot] == 0)
+                return;
+            const std::uint64_t residency = now() - _timestamps[slot];
+            _timestamps[slot] = 0;
+            _stats.residency_samples++;
+            _stats.residency_total_ns += residency;
+            if(residency > _stats.residency_max_ns)
+                _stats.residency_max_ns = residency;
+        }
+
+        void swap(cbuffer_counters &other) {
+            cbuffer_counters<1>::swap(other);
+            _timestamps.swap(other._timestamps);
+            std::swap(_sample, other._sample);
+        }
+
+    private:
+        std::vector<std::uint64_t> _timestamps;
+        unsigned int _sample;
+
+        static std::uint64_t now() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count() + 1;
+        }
+};
+
+#endif
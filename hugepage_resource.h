@@ -0,0 +1,113 @@
+#ifndef HUGEPAGE_RESOURCE_H
+#define HUGEPAGE_RESOURCE_H
+
+#include <cerrno>
+#include <cstddef>         // std::size_t
+#include <memory_resource> // std::pmr::memory_resource
+#include <new>             // std::bad_alloc
+#include <sys/mman.h>      // mmap, munmap, madvise
+#include <sys/syscall.h>   // SYS_mbind, SYS_getcpu
+#include <unistd.h>        // syscall
+
+/**
+ * @file hugepage_resource.h
+ * @brief Dichiarazione della classe hugepage_resource
+ *
+ * memory_resource per Linux che alloca grandi blocchi direttamente con mmap, su pagine
+ * da 2 MiB, ed eventualmente li vincola a un nodo NUMA. Pensata per cbuffer molto grandi
+ * (pmr::cbuffer), dove le pagine piccole causano molti TLB miss.
+ * Ogni allocazione è una mappatura separata: non adatta a molte allocazioni piccole.
+**/
+
+class hugepage_resource : public std::pmr::memory_resource {
+    public:
+        /**
+         * @brief Costruttore
+         *
+         * @param node Nodo NUMA a cui vincolare la memoria, oppure -1 per nessun vincolo
+         * @param hugetlb Se true usa prima le pagine riservate di hugetlbfs (MAP_HUGETLB);
+         *        in ogni caso, se non disponibili, richiede le transparent huge pages con madvise
+        **/
+        explicit hugepage_resource(int node = -1, bool hugetlb = false) : _node(node), _hugetlb(hugetlb) {
+        }
+
+        /**
+         * @brief Nodo NUMA del processore corrente
+         *
+         * Utile per vincolare il buffer al nodo del thread consumatore.
+         * @return Il nodo NUMA su cui sta girando il thread chiamante, 0 se non disponibile
+        **/
+        static int current_node() {
+            unsigned int cpu = 0, node = 0;
+            if(syscall(SYS_getcpu, &cpu, &node, 0) != 0)
+                return 0;
+            return static_cast<int>(node);
+        }
+
+        /**
+         * @brief Nodo NUMA configurato
+         *
+         * @return Il nodo a cui viene vincolata la memoria, -1 se nessuno
+        **/
+        int node() const {
+            return _node;
+        }
+
+    private:
+        static const std::size_t huge_page = std::size_t(2) << 20;
+
+        int _node;
+        bool _hugetlb;
+
+        static std::size_t round_up(std::size_t bytes) {
+            return (bytes + huge_page - 1) / huge_page * huge_page;
+        }
+
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+            if(alignment > huge_page)
+                throw std::bad_alloc();
+            const std::size_t length = round_up(bytes ? bytes : 1);
+
+            void *p = MAP_FAILED;
+            if(_hugetlb)
+                p = mmap(0, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if(p == MAP_FAILED) {
+                //Le transparent huge pages richiedono un indirizzo allineato a 2 MiB:
+                //si mappa un blocco più grande e si tagliano gli eccessi
+                void *raw = mmap(0, length + huge_page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if(raw == MAP_FAILED)
+                    throw std::bad_alloc();
+                char *begin = static_cast<char*>(raw);
+                char *aligned = begin + (huge_page - reinterpret_cast<std::size_t>(begin) % huge_page) % huge_page;
+                if(aligned != begin)
+                    munmap(begin, aligned - begin);
+                if(aligned + length != begin + length + huge_page)
+                    munmap(aligned + length, begin + length + huge_page - (aligned + length));
+                p = aligned;
+                madvise(p, length, MADV_HUGEPAGE);
+            }
+
+            if(_node >= 0) {
+                //mbind(MPOL_BIND) prima che le pagine vengano toccate; se fallisce
+                //(kernel senza NUMA) la memoria resta con la politica di default
+                const int mpol_bind = 2;
+                unsigned long mask[16] = {0};
+                const unsigned long bits = 8 * sizeof(unsigned long);
+                if(static_cast<unsigned long>(_node) < 16 * bits) {
+                    mask[_node / bits] = 1UL << (_node % bits);
+                    syscall(SYS_mbind, p, length, mpol_bind, mask, 16 * bits, 0);
+                }
+            }
+            return p;
+        }
+
+        void do_deallocate(void *p, std::size_t bytes, std::size_t) override {
+            munmap(p, round_up(bytes ? bytes : 1));
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+            return this == &other;
+        }
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include <iostream>
 #include "cbuffer.h"
+#include "cbuffer_algo.h"
 #include "person.h"
 
 
@@ -56,8 +57,8 @@ void test_metodi_fondamentali() {
  * @param value Il valore da verificare
  * @return Valore booleano risultante dal confronto
 **/
-struct positive_int{
-    inline bool operator()(const int& value) {return (value >= 0);}
+struct positive_int : threshold<int, cmp_op::ge> {
+    positive_int() : threshold<int, cmp_op::ge>{0} {}
 };
 
 /**
@@ -67,8 +68,8 @@ struct positive_int{
  * @param value Il valore da verificare
  * @return Valore booleano risultante dal confronto
 **/
-struct negative_int {
-    inline bool operator()(const int &value) {return (value < 0);}
+struct negative_int : threshold<int, cmp_op::lt> {
+    negative_int() : threshold<int, cmp_op::lt>{0} {}
 };
 
 /**
@@ -86,19 +87,21 @@ struct srn_ray {
  * @brief Valuta elementi del buffer
  * 
  * Verifica se gli elementi di un buffer soddisfino un predicato unario,
- * che riceve in input l'elemento del buffer da verificare
+ * che riceve in input l'elemento del buffer da verificare.
+ * Il predicato viene valutato su tutto il buffer con evaluate_mask, senza copiarlo.
  * 
  * @param cb buffer circolare di elementi generici
  * @param pred funtore unario 
 **/
 template <typename T, typename P>
-void evaluate_if(cbuffer<T> cb, P pred) {
+void evaluate_if(const cbuffer<T> &cb, P pred) {
     typename cbuffer<T>::size_type i;
     typename cbuffer<T>::size_type size = cb.size();
+    const std::vector<std::uint64_t> mask = evaluate_mask(cb, pred);
 
     for(i = 0; i < size; i++) {
         std::cout << "[" << i << "]: ";
-        if(pred(cb[i]))
+        if((mask[i / 64] >> (i % 64)) & 1)
             std::cout << "true" << std::endl;
         else
             std::cout << "false" << std::endl;
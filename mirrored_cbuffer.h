@@ -0,0 +1,289 @@
+#ifndef MIRRORED_CBUFFER_H
+#define MIRRORED_CBUFFER_H
+
+#include <cstddef>      // std::size_t
+#include <cstring>      // std::memcpy
+#include <cassert>
+#include <cerrno>
+#include <system_error> // std::system_error
+#include <type_traits>
+#include <utility>      // std::pair
+#include <sys/mman.h>   // mmap, munmap, memfd_create
+#include <unistd.h>     // sysconf, ftruncate, close
+
+/**
+ * @file mirrored_cbuffer.h
+ * @brief Dichiarazione della classe mirrored_cbuffer
+ *
+ * Buffer circolare di elementi banalmente copiabili con memoria "a specchio": le stesse
+ * pagine fisiche sono mappate due volte, una dopo l'altra, nello spazio di indirizzamento.
+ * Qualunque finestra di al più capacity() elementi che parte dalla testa è quindi contigua,
+ * e gli elementi presenti si possono passare a memcpy, write o a un parser come
+ * un unico puntatore più lunghezza. Solo Linux (memfd_create).
+**/
+
+template <class T>
+class mirrored_cbuffer {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "mirrored_cbuffer richiede un tipo banalmente copiabile");
+
+    public:
+        typedef unsigned int size_type;
+        typedef std::pair<T*, size_type> array_range;
+
+        /**
+         * @brief Costruttore secondario
+         *
+         * Mappa due volte un file anonimo in memoria. La capacità viene arrotondata
+         * per eccesso in modo che capacity() * sizeof(T) sia un multiplo della pagina.
+         * @param capacity Numero minimo di elementi contenuti
+         * @throw std::system_error se la mappatura fallisce
+        **/
+        explicit mirrored_cbuffer(size_type capacity) : _buffer(0), _capacity(0), _head(0), _size(0) {
+            const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+            std::size_t step = page / gcd(page, sizeof(T));
+            std::size_t elements = (capacity + step - 1) / step * step;
+            if(elements == 0)
+                elements = step;
+            const std::size_t bytes = elements * sizeof(T);
+
+            const int fd = memfd_create("mirrored_cbuffer", MFD_CLOEXEC);
+            if(fd < 0)
+                throw std::system_error(errno, std::generic_category(), "memfd_create");
+            if(ftruncate(fd, bytes) != 0)
+                fail(fd, 0, 0, "ftruncate");
+
+            void *base = mmap(0, 2 * bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(base == MAP_FAILED)
+                fail(fd, 0, 0, "mmap");
+            char *first = static_cast<char*>(base);
+            if(mmap(first, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+                fail(fd, base, 2 * bytes, "mmap");
+            if(mmap(first + bytes, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+                fail(fd, base, 2 * bytes, "mmap");
+            close(fd);
+
+            _buffer = reinterpret_cast<T*>(first);
+            _capacity = static_cast<size_type>(elements);
+        }
+
+        /**
+         * @brief Distruttore
+         *
+         * Rimuove entrambe le mappature.
+        **/
+        ~mirrored_cbuffer() {
+            if(_buffer != 0)
+                munmap(_buffer, 2 * std::size_t(_capacity) * sizeof(T));
+            _buffer = 0;
+        }
+
+        /**
+         * @brief Capacità del buffer
+         *
+         * @return Il numero massimo di elementi contenuti
+        **/
+        size_type capacity() const {
+            return _capacity;
+        }
+
+        /**
+         * @brief Dimensione del buffer
+         *
+         * @return Il numero di elementi presenti
+        **/
+        size_type size() const {
+            return _size;
+        }
+
+        /**
+         * @brief Spazio libero
+         *
+         * @return Il numero di elementi che si possono inserire senza sovrascrivere
+        **/
+        size_type space() const {
+            return _capacity - _size;
+        }
+
+        /**
+         * @brief Indice della testa
+         *
+         * @return L'indice in cui è memorizzata la testa del buffer
+        **/
+        size_type head() const {
+            return _head;
+        }
+
+        /**
+         * @brief Accesso all'elemento index-esimo
+         *
+         * Grazie alla seconda mappatura non serve alcuna riduzione dell'indice.
+         * @pre index < size()
+        **/
+        T &operator[](size_type index) {
+            assert(index < _size);
+            return _buffer[_head + index];
+        }
+
+        /**
+         * @brief Accesso all'elemento index-esimo in sola lettura
+         *
+         * @pre index < size()
+        **/
+        const T &operator[](size_type index) const {
+            assert(index < _size);
+            return _buffer[_head + index];
+        }
+
+        /**
+         * @brief Elementi presenti come unico blocco contiguo
+         *
+         * Il puntatore è valido per size() elementi consecutivi, anche se il buffer gira.
+         * @return Il puntatore all'elemento in testa
+        **/
+        const T *data() const {
+            return _buffer + _head;
+        }
+
+        /**
+         * @brief Elementi presenti come coppia puntatore, lunghezza
+         *
+         * @return Il blocco contiguo degli elementi presenti
+        **/
+        array_range array() {
+            return array_range(_buffer + _head, _size);
+        }
+
+        /**
+         * @brief Spazio libero come unico blocco contiguo
+         *
+         * Permette di scrivere direttamente nel buffer (ad esempio con read(2)) fino a
+         * space() elementi; i dati diventano visibili dopo commit().
+         * @return Il puntatore al primo slot libero
+        **/
+        T *write_ptr() {
+            return _buffer + _head + _size;
+        }
+
+        /**
+         * @brief Conferma di una scrittura diretta
+         *
+         * Aggiunge in coda gli n elementi scritti tramite write_ptr().
+         * @pre n <= space()
+         * @param n Numero di elementi scritti
+        **/
+        void commit(size_type n) {
+            assert(n <= space());
+            _size += n;
+        }
+
+        /**
+         * @brief Inserimento di un nuovo elemento
+         *
+         * Inserisce un elemento in coda; se il buffer è pieno sovrascrive il più vecchio.
+         * @param value Un elemento da inserire
+        **/
+        void insert(const T &value) {
+            _buffer[_head + _size] = value;
+            if(_size == _capacity)
+                advance(1);
+            else
+                _size++;
+        }
+
+        /**
+         * @brief Scrittura di un array di elementi
+         *
+         * Inserisce in coda n elementi con un'unica memcpy. Se non c'è spazio vengono
+         * eliminati gli elementi più vecchi; di più di capacity() elementi restano gli ultimi.
+         * @param src Puntatore al primo elemento da inserire
+         * @param n Numero di elementi da inserire
+        **/
+        void write(const T *src, size_type n) {
+            if(n > _capacity) {
+                src += n - _capacity;
+                n = _capacity;
+            }
+            if(n > space())
+                remove(n - space());
+            std::memcpy(static_cast<void*>(write_ptr()), src, std::size_t(n) * sizeof(T));
+            _size += n;
+        }
+
+        /**
+         * @brief Lettura di un blocco di elementi
+         *
+         * Copia in dst fino a n elementi dalla testa con un'unica memcpy e li rimuove.
+         * @param dst Puntatore ad un array di almeno n elementi
+         * @param n Numero massimo di elementi da leggere
+         * @return Il numero di elementi letti
+        **/
+        size_type read(T *dst, size_type n) {
+            if(n > _size)
+                n = _size;
+            std::memcpy(static_cast<void*>(dst), data(), std::size_t(n) * sizeof(T));
+            remove(n);
+            return n;
+        }
+
+        /**
+         * @brief Rimozione di un elemento
+         *
+         * Rimuove l'elemento in testa, se presente.
+        **/
+        void remove() {
+            if(_size != 0)
+                remove(1);
+        }
+
+        /**
+         * @brief Rimozione di più elementi
+         *
+         * Rimuove i primi n elementi, ad esempio dopo averli consumati tramite data().
+         * @pre n <= size()
+         * @param n Numero di elementi da rimuovere
+        **/
+        void remove(size_type n) {
+            assert(n <= _size);
+            advance(n);
+            _size -= n;
+        }
+
+    private:
+        //Non copiabile: possiede le mappature
+        mirrored_cbuffer(const mirrored_cbuffer &other);
+        mirrored_cbuffer &operator=(const mirrored_cbuffer &other);
+
+        T* _buffer;
+        size_type _capacity;
+        size_type _head;
+        size_type _size;
+
+        //Avanza la testa di n posizioni (n <= _capacity)
+        void advance(size_type n) {
+            _head += n;
+            if(_head >= _capacity)
+                _head -= _capacity;
+        }
+
+        //Massimo comun divisore
+        static std::size_t gcd(std::size_t a, std::size_t b) {
+            while(b != 0) {
+                const std::size_t r = a % b;
+                a = b;
+                b = r;
+            }
+            return a;
+        }
+
+        //Rilascia le risorse di un costruttore fallito e lancia l'eccezione
+        static void fail(int fd, void *base, std::size_t bytes, const char *what) {
+            const int err = errno;
+            if(base != 0)
+                munmap(base, bytes);
+            close(fd);
+            throw std::system_error(err, std::generic_category(), what);
+        }
+};
+
+#endif
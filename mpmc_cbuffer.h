@@ -0,0 +1,164 @@
+#ifndef MPMC_CBUFFER_H
+#define MPMC_CBUFFER_H
+
+#include <atomic>
+#include <cstddef> // std::size_t
+#include <limits>
+#include <stdexcept>
+#include <utility> // std::move
+
+/**
+ * @file mpmc_cbuffer.h
+ * @brief Dichiarazione della classe mpmc_cbuffer
+ *
+ * Buffer circolare limitato per più produttori e più consumatori.
+ * Ogni slot ha un proprio numero di sequenza: produttori e consumatori si
+ * contendono solo un contatore atomico ciascuno, senza lock globali.
+**/
+
+#ifndef CBUFFER_CACHE_LINE
+#define CBUFFER_CACHE_LINE 64
+#endif
+
+template <class T>
+class mpmc_cbuffer {
+    public:
+        typedef unsigned int size_type;
+
+        /**
+         * @brief Costruttore secondario
+         *
+         * Costruttore che prende in input la capacità del buffer, arrotondata
+         * alla potenza di due successiva per indicizzare con una maschera. Gli slot sono
+         * almeno due: con uno solo il numero di sequenza di uno slot pieno coinciderebbe
+         * con quello atteso dal produttore successivo, che sovrascriverebbe l'elemento.
+         * @param capacity Numero minimo di elementi contenuti
+         * @throw std::length_error se capacity supera la più grande potenza di due di size_type
+         * @throw Eccezione di allocazione memoria
+        **/
+        explicit mpmc_cbuffer(size_type capacity) : _buffer(0), _mask(0), _enqueue(0), _dequeue(0) {
+            if(capacity > (std::numeric_limits<size_type>::max() >> 1) + 1)
+                throw std::length_error("mpmc_cbuffer: capacity too large");
+            size_type slots = 2;
+            while(slots < capacity)
+                slots <<= 1;
+            _buffer = new slot[slots];
+            _mask = slots - 1;
+            for(size_type i = 0; i < slots; i++)
+                _buffer[i].seq.store(i, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Distruttore
+         *
+         * Distruttore della classe mpmc_cbuffer
+        **/
+        ~mpmc_cbuffer() {
+            delete[] _buffer;
+            _buffer = 0;
+        }
+
+        /**
+         * @brief Inserimento non bloccante
+         *
+         * Inserisce un elemento in coda al buffer, se c'è spazio.
+         * Può essere chiamato da più thread contemporaneamente.
+         * @param value Un elemento da inserire
+         * @return true se l'elemento è stato inserito, false se il buffer è pieno
+        **/
+        bool try_push(const T &value) {
+            std::size_t pos = _enqueue.load(std::memory_order_relaxed);
+            slot *s;
+            for(;;) {
+                s = &_buffer[pos & _mask];
+                const std::size_t seq = s->seq.load(std::memory_order_acquire);
+                const std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+                if(diff == 0) {
+                    if(_enqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if(diff < 0)
+                    return false;
+                else
+                    pos = _enqueue.load(std::memory_order_relaxed);
+            }
+            s->data = value;
+            s->seq.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Estrazione non bloccante
+         *
+         * Estrae l'elemento in testa al buffer, se presente.
+         * Può essere chiamato da più thread contemporaneamente.
+         * @param value Reference in cui viene spostato l'elemento estratto
+         * @return true se un elemento è stato estratto, false se il buffer è vuoto
+        **/
+        bool try_pop(T &value) {
+            std::size_t pos = _dequeue.load(std::memory_order_relaxed);
+            slot *s;
+            for(;;) {
+                s = &_buffer[pos & _mask];
+                const std::size_t seq = s->seq.load(std::memory_order_acquire);
+                const std::ptrdiff_t diff = (std::ptrdiff_t)seq - (std::ptrdiff_t)(pos + 1);
+                if(diff == 0) {
+                    if(_dequeue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if(diff < 0)
+                    return false;
+                else
+                    pos = _dequeue.load(std::memory_order_relaxed);
+            }
+            value = std::move(s->data);
+            s->seq.store(pos + _mask + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Capacità del buffer
+         *
+         * @return Il numero massimo di elementi contenuti (potenza di due)
+        **/
+        size_type capacity() const {
+            return _mask + 1;
+        }
+
+        /**
+         * @brief Dimensione del buffer
+         *
+         * Ritorna una stima del numero di elementi presenti, esatta solo a buffer fermo.
+         * @return Il numero di elementi presenti
+        **/
+        size_type size() const {
+            const std::size_t dequeue = _dequeue.load(std::memory_order_acquire);
+            const std::size_t enqueue = _enqueue.load(std::memory_order_acquire);
+            return (enqueue > dequeue) ? (size_type)(enqueue - dequeue) : 0;
+        }
+
+    private:
+        //Non copiabile: i contatori atomici sono condivisi tra i thread
+        mpmc_cbuffer(const mpmc_cbuffer &other);
+        mpmc_cbuffer &operator=(const mpmc_cbuffer &other);
+
+        /**
+         * Slot del buffer: seq == posizione quando lo slot è libero per il
+         * produttore di quella posizione, posizione + 1 quando è pieno.
+        **/
+        struct slot {
+            std::atomic<std::size_t> seq;
+            T data;
+        };
+
+        slot* _buffer;
+        std::size_t _mask;
+
+        //Contatore dei produttori
+        alignas(CBUFFER_CACHE_LINE) std::atomic<std::size_t> _enqueue;
+
+        //Contatore dei consumatori
+        alignas(CBUFFER_CACHE_LINE) std::atomic<std::size_t> _dequeue;
+};
+
+#endif
@@ -0,0 +1,313 @@
+#ifndef PERSISTENT_CBUFFER_H
+#define PERSISTENT_CBUFFER_H
+
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>      // std::size_t
+#include <cstdint>      // std::uint32_t, std::uint64_t
+#include <cstring>      // std::memcpy
+#include <stdexcept>
+#include <string>
+#include <system_error> // std::system_error
+#include <type_traits>
+#include <fcntl.h>      // open
+#include <sys/mman.h>   // mmap, msync, munmap
+#include <sys/stat.h>   // fstat
+#include <unistd.h>     // ftruncate, pread, close
+
+/**
+ * @file persistent_cbuffer.h
+ * @brief Dichiarazione della classe persistent_cbuffer
+ *
+ * Buffer circolare di elementi banalmente copiabili memorizzato in un file mappato in memoria.
+ * Testa e dimensione sono impacchettate in un'unica parola a 64 bit nell'intestazione del file,
+ * aggiornata con una sola scrittura atomica dopo aver scritto i dati: un processo che termina
+ * in qualunque punto lascia il file in uno stato coerente, e la riapertura costa O(1).
+ * La coerenza vale solo per la terminazione del processo, le cui scritture restano nella
+ * cache delle pagine. In caso di caduta del sistema o di interruzione dell'alimentazione
+ * il kernel può scrivere su disco le pagine in qualunque ordine, anche durante sync():
+ * sync() garantisce solo che al suo ritorno le scritture precedenti siano sul dispositivo.
+**/
+
+template <class T>
+class persistent_cbuffer {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "persistent_cbuffer richiede un tipo banalmente copiabile");
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free &&
+                  sizeof(std::atomic<std::uint64_t>) == sizeof(std::uint64_t),
+                  "persistent_cbuffer richiede atomici lock-free");
+
+    public:
+        typedef unsigned int size_type;
+
+        /**
+         * @brief Costruttore secondario
+         *
+         * Apre il file path, creandolo se non esiste. Un file già esistente viene riaperto
+         * con il suo contenuto, purché sia stato creato con la stessa capacità e lo stesso tipo.
+         * L'intestazione di un file esistente viene verificata prima di modificarne la
+         * dimensione, quindi un file rifiutato resta intatto.
+         * @param path Percorso del file
+         * @param capacity Numero massimo di elementi contenuti
+         * @throw std::system_error se il file non può essere aperto o mappato
+         * @throw std::runtime_error se il file esiste ma non è compatibile, è troncato
+         *        o contiene una testa o una dimensione non valide
+        **/
+        persistent_cbuffer(const std::string &path, size_type capacity) : _file(0), _bytes(0), _data(0), _slots(capacity + 1) {
+            const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            if(fd < 0)
+                throw std::system_error(errno, std::generic_category(), "open " + path);
+
+            _bytes = data_offset() + std::size_t(_slots) * sizeof(T);
+            struct stat st;
+            if(fstat(fd, &st) != 0) {
+                const int err = errno;
+                close(fd);
+                throw std::system_error(err, std::generic_category(), "fstat " + path);
+            }
+
+            //Un file già inizializzato viene verificato prima di essere ridimensionato
+            header_fields h;
+            if(std::size_t(st.st_size) >= sizeof(h) && pread(fd, &h, sizeof(h), 0) == ssize_t(sizeof(h)) &&
+               h.magic == magic_value) {
+                if(h.version != version_value || h.element_size != sizeof(T) || h.capacity != capacity) {
+                    close(fd);
+                    throw std::runtime_error("persistent_cbuffer: file incompatibile " + path);
+                }
+                if(std::size_t(st.st_size) < _bytes) {
+                    close(fd);
+                    throw std::runtime_error("persistent_cbuffer: file troncato " + path);
+                }
+            }
+            if(std::size_t(st.st_size) < _bytes && ftruncate(fd, _bytes) != 0) {
+                const int err = errno;
+                close(fd);
+                throw std::system_error(err, std::generic_category(), "ftruncate " + path);
+            }
+
+            void *base = mmap(0, _bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            const int err = errno;
+            close(fd);
+            if(base == MAP_FAILED)
+                throw std::system_error(err, std::generic_category(), "mmap " + path);
+
+            _file = static_cast<header*>(base);
+            _data = reinterpret_cast<T*>(static_cast<char*>(base) + data_offset());
+
+            //Il magic va letto prima degli altri campi, che sono validi solo dopo la sua pubblicazione
+            if(_file->magic.load(std::memory_order_acquire) != magic_value) {
+                //File nuovo, o creazione interrotta prima della scrittura del magic
+                _file->version = version_value;
+                _file->element_size = sizeof(T);
+                _file->capacity = capacity;
+                _file->state.store(0, std::memory_order_relaxed);
+                //Pubblicato per ultimo: chi legge il magic vede l'intestazione completa
+                _file->magic.store(magic_value, std::memory_order_release);
+            }
+            else if(_file->version != version_value || _file->element_size != sizeof(T) ||
+                    _file->capacity != capacity) {
+                munmap(base, _bytes);
+                _file = 0;
+                throw std::runtime_error("persistent_cbuffer: file incompatibile " + path);
+            }
+            else {
+                //Testa e dimensione vengono dal file: indici fuori dal buffer lo renderebbero illeggibile
+                const std::uint64_t s = _file->state.load(std::memory_order_acquire);
+                if(state_head(s) >= _slots || state_size(s) > capacity) {
+                    munmap(base, _bytes);
+                    _file = 0;
+                    throw std::runtime_error("persistent_cbuffer: stato non valido " + path);
+                }
+            }
+        }
+
+        /**
+         * @brief Distruttore
+         *
+         * Rimuove la mappatura. I dati restano nel file (il kernel li scrive su disco).
+        **/
+        ~persistent_cbuffer() {
+            if(_file != 0)
+                munmap(_file, _bytes);
+            _file = 0;
+        }
+
+        /**
+         * @brief Capacità del buffer
+         *
+         * @return Il numero massimo di elementi contenuti
+        **/
+        size_type capacity() const {
+            return _slots - 1;
+        }
+
+        /**
+         * @brief Dimensione del buffer
+         *
+         * @return Il numero di elementi presenti
+        **/
+        size_type size() const {
+            return state_size(_file->state.load(std::memory_order_acquire));
+        }
+
+        /**
+         * @brief Indice della testa
+         *
+         * @return L'indice in cui è memorizzata la testa del buffer
+        **/
+        size_type head() const {
+            return state_head(_file->state.load(std::memory_order_acquire));
+        }
+
+        /**
+         * @brief Accesso all'elemento index-esimo
+         *
+         * @pre index < size()
+         * @param index l'indice della posizione del buffer a cui si vuole accedere
+        **/
+        const T &operator[](size_type index) const {
+            const std::uint64_t s = _file->state.load(std::memory_order_acquire);
+            assert(index < state_size(s));
+            return _data[wrap(state_head(s) + index)];
+        }
+
+        /**
+         * @brief Inserimento di un nuovo elemento
+         *
+         * Scrive l'elemento nello slot libero di coda e poi pubblica il nuovo stato.
+         * C'è sempre almeno uno slot libero, quindi anche a buffer pieno l'elemento più
+         * vecchio resta intatto finché lo stato non lo esclude.
+         * @param value Un elemento da inserire
+        **/
+        void insert(const T &value) {
+            const std::uint64_t s = _file->state.load(std::memory_order_relaxed);
+            size_type head = state_head(s), size = state_size(s);
+            std::memcpy(static_cast<void*>(_data + wrap(head + size)), &value, sizeof(T));
+            if(size == capacity())
+                head = wrap(head + 1);
+            else
+                size++;
+            publish(head, size);
+        }
+
+        /**
+         * @brief Scrittura di un array di elementi
+         *
+         * Inserisce in coda n elementi. Se non c'è spazio gli elementi più vecchi vengono prima
+         * esclusi dallo stato, poi i nuovi sono copiati in al più due blocchi e pubblicati
+         * con un'unica scrittura dello stato.
+         * @param src Puntatore al primo elemento da inserire
+         * @param n Numero di elementi da inserire
+        **/
+        void write(const T *src, size_type n) {
+            const size_type cap = capacity();
+            if(n > cap) {
+                src += n - cap;
+                n = cap;
+            }
+            const std::uint64_t s = _file->state.load(std::memory_order_relaxed);
+            size_type head = state_head(s), size = state_size(s);
+            if(n > cap - size) {
+                const size_type drop = n - (cap - size);
+                head = wrap(head + drop);
+                size -= drop;
+                publish(head, size);
+            }
+
+            const size_type tail = wrap(head + size);
+            const size_type one = (n < _slots - tail) ? n : _slots - tail;
+            std::memcpy(static_cast<void*>(_data + tail), src, std::size_t(one) * sizeof(T));
+            std::memcpy(static_cast<void*>(_data), src + one, std::size_t(n - one) * sizeof(T));
+            publish(head, size + n);
+        }
+
+        /**
+         * @brief Rimozione di un elemento
+         *
+         * Rimuove l'elemento in testa, se presente.
+        **/
+        void remove() {
+            const std::uint64_t s = _file->state.load(std::memory_order_relaxed);
+            if(state_size(s) != 0)
+                publish(wrap(state_head(s) + 1), state_size(s) - 1);
+        }
+
+        /**
+         * @brief Svuotamento del buffer
+        **/
+        void clear() {
+            publish(0, 0);
+        }
+
+        /**
+         * @brief Scrittura su disco
+         *
+         * Attende che dati e intestazione siano scritti sul dispositivo (msync sincrona).
+         * @throw std::system_error se msync fallisce
+        **/
+        void sync() {
+            if(msync(_file, _bytes, MS_SYNC) != 0)
+                throw std::system_error(errno, std::generic_category(), "msync");
+        }
+
+    private:
+        //Non copiabile: possiede la mappatura
+        persistent_cbuffer(const persistent_cbuffer &other);
+        persistent_cbuffer &operator=(const persistent_cbuffer &other);
+
+        static const std::uint64_t magic_value = 0x5245464655424350ULL; // "PCBUFFER"
+        static const std::uint32_t version_value = 1;
+
+        /**
+         * Intestazione del file. state contiene la testa nei 32 bit bassi e
+         * la dimensione nei 32 bit alti.
+        **/
+        struct header {
+            std::atomic<std::uint64_t> magic;  // scritto per ultimo alla creazione
+            std::uint32_t version;
+            std::uint32_t element_size;
+            std::uint32_t capacity;
+            std::uint32_t reserved;
+            std::atomic<std::uint64_t> state;
+        };
+
+        //Campi iniziali dell'intestazione, letti con pread prima della mappatura
+        struct header_fields {
+            std::uint64_t magic;
+            std::uint32_t version;
+            std::uint32_t element_size;
+            std::uint32_t capacity;
+        };
+
+        header* _file;
+        std::size_t _bytes;
+        T* _data;
+        size_type _slots;
+
+        //Posizione dei dati nel file, allineata alla cache e al tipo T
+        static std::size_t data_offset() {
+            const std::size_t align = (alignof(T) > 64) ? alignof(T) : 64;
+            return (sizeof(header) + align - 1) / align * align;
+        }
+
+        static size_type state_head(std::uint64_t s) {
+            return static_cast<size_type>(s & 0xffffffffu);
+        }
+
+        static size_type state_size(std::uint64_t s) {
+            return static_cast<size_type>(s >> 32);
+        }
+
+        //Pubblica testa e dimensione con un'unica scrittura atomica
+        void publish(size_type head, size_type size) {
+            _file->state.store((std::uint64_t(size) << 32) | head, std::memory_order_release);
+        }
+
+        //Riduzione di un indice fisico minore di 2 * _slots
+        size_type wrap(size_type i) const {
+            return (i >= _slots) ? i - _slots : i;
+        }
+};
+
+#endif
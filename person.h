@@ -14,7 +14,7 @@ struct person {
     std::string surname;
 
     /**
-     * Costruttore di default, necessario per poter creare un array di person.
+     * Costruttore di default. Non è richiesto da cbuffer, che costruisce gli elementi solo all'inserimento.
     **/
     person() {}
 
@@ -0,0 +1,382 @@
+#ifndef RECORD_CBUFFER_H
+#define RECORD_CBUFFER_H
+
+#include <cassert>
+#include <cstddef>      // std::size_t, std::ptrdiff_t
+#include <cstdint>      // std::uint32_t
+#include <cstring>      // std::memcpy
+#include <initializer_list>
+#include <iterator>     // std::forward_iterator_tag
+#include <ostream>      // std::ostream
+#include <stdexcept>
+#include <string_view>
+
+/**
+ * @file record_cbuffer.h
+ * @brief Dichiarazione della classe record_cbuffer
+ *
+ * Buffer circolare di record di lunghezza variabile memorizzati in un'unica area di byte.
+ * Un record è una sequenza di campi di testo (ad esempio nome e cognome di una person):
+ * i campi vengono copiati nell'area, preceduti dalla propria lunghezza, invece di essere
+ * allocati sullo heap uno per uno come le std::string di un cbuffer<person>.
+ * I lettori ricevono dei record_view, i cui campi sono std::string_view nell'area.
+**/
+
+/**
+ * @brief Vista di un record di record_cbuffer
+ *
+ * Resta valida finché il record non viene rimosso o sovrascritto.
+**/
+class record_view {
+    public:
+        typedef unsigned int size_type;
+
+        /**
+         * @brief Numero di campi del record
+        **/
+        size_type fields() const {
+            size_type n = 0;
+            for(size_type pos = 0; pos < _bytes; n++)
+                pos += sizeof(std::uint32_t) + length(pos);
+            return n;
+        }
+
+        /**
+         * @brief Campo index-esimo del record
+         *
+         * I campi sono memorizzati uno dopo l'altro: l'accesso costa O(index).
+         * @pre index < fields()
+        **/
+        std::string_view field(size_type index) const {
+            size_type pos = 0;
+            for(; index != 0; index--)
+                pos += sizeof(std::uint32_t) + length(pos);
+            assert(pos < _bytes);
+            return std::string_view(_data + pos + sizeof(std::uint32_t), length(pos));
+        }
+
+        std::string_view operator[](size_type index) const {
+            return field(index);
+        }
+
+        /**
+         * @brief Byte occupati dai campi, lunghezze comprese
+        **/
+        size_type bytes() const {
+            return _bytes;
+        }
+
+    private:
+        const char *_data;
+        size_type _bytes;
+
+        friend class record_cbuffer;
+
+        record_view(const char *data, size_type bytes) : _data(data), _bytes(bytes) {
+        }
+
+        size_type length(size_type pos) const {
+            std::uint32_t n;
+            std::memcpy(&n, _data + pos, sizeof(n));
+            return n;
+        }
+};
+
+/**
+ * @brief Operatore di stream in output
+ *
+ * Stampa i campi del record separati da uno spazio.
+**/
+inline std::ostream &operator<<(std::ostream &os, const record_view &r) {
+    const record_view::size_type n = r.fields();
+    for(record_view::size_type i = 0; i < n; i++)
+        os << (i ? " " : "") << r.field(i);
+    return os;
+}
+
+/**
+ * @brief Buffer circolare di record di lunghezza variabile
+ *
+ * Ogni record è un'intestazione di 4 byte con la lunghezza del corpo, seguita dai campi
+ * (4 byte di lunghezza più i caratteri) e arrotondata a un multiplo di 4 byte. Un record
+ * non viene mai diviso: se non c'è spazio prima della fine dell'area, il resto dell'area
+ * diventa padding (marcato nell'intestazione) e il record viene scritto dall'inizio.
+ * Come cbuffer, l'inserimento elimina i record più vecchi finché il nuovo non sta nel
+ * budget di byte, che di default è l'intera area.
+ * La copia non è supportata.
+**/
+class record_cbuffer {
+    public:
+        typedef unsigned int size_type;
+        class const_iterator;
+
+        /**
+         * @brief Costruttore secondario
+         *
+         * @param bytes Dimensione dell'area, arrotondata per eccesso a un multiplo di 4
+         * @throw Eccezione di allocazione memoria
+        **/
+        explicit record_cbuffer(size_type bytes) : _data(0), _capacity(align(bytes)), _budget(_capacity),
+                _head(0), _tail(0), _used(0), _size(0) {
+            _data = new char[_capacity];
+        }
+
+        /**
+         * @brief Distruttore
+        **/
+        ~record_cbuffer() {
+            delete[] _data;
+            _data = 0;
+        }
+
+        /**
+         * @brief Dimensione dell'area in byte
+        **/
+        size_type capacity() const {
+            return _capacity;
+        }
+
+        /**
+         * @brief Numero di record presenti
+        **/
+        size_type size() const {
+            return _size;
+        }
+
+        /**
+         * @brief Byte occupati da record e padding
+        **/
+        size_type used() const {
+            return _used;
+        }
+
+        /**
+         * @brief Budget di byte
+        **/
+        size_type budget() const {
+            return _budget;
+        }
+
+        /**
+         * @brief Modifica del budget di byte
+         *
+         * Limita i byte occupati (padding compreso) a bytes, eliminando subito
+         * i record più vecchi se necessario.
+         * @param bytes Nuovo budget, al più capacity()
+         * @throw std::invalid_argument se bytes > capacity()
+        **/
+        void set_budget(size_type bytes) {
+            if(bytes > _capacity)
+                throw std::invalid_argument("Budget exceeds capacity");
+            _budget = bytes;
+            while(_used > _budget)
+                remove();
+        }
+
+        /**
+         * @brief Byte occupati da un record con questi campi
+         *
+         * @param fields I campi del record
+         * @return Intestazione, lunghezze e caratteri, arrotondati a un multiplo di 4
+        **/
+        static std::size_t record_bytes(std::initializer_list<std::string_view> fields) {
+            return (header + body_bytes(fields) + header - 1) / header * header;
+        }
+
+        /**
+         * @brief Inserimento di un record
+         *
+         * Copia i campi in coda all'area; se non c'è spazio nel budget vengono eliminati
+         * i record più vecchi. Non alloca memoria.
+         * @param fields I campi del record, ad esempio {p.name, p.surname}
+         * @throw std::length_error se il record supera il budget
+        **/
+        void insert(std::initializer_list<std::string_view> fields) {
+            const std::size_t body = body_bytes(fields);
+            if(record_bytes(fields) > _budget)
+                throw std::length_error("Record exceeds budget");
+            const size_type stride = align(header + static_cast<size_type>(body));
+            if(_size == 0)
+                _head = _tail = _used = 0;
+
+            size_type pos = _tail, pad = 0;
+            if(_capacity - _tail < stride) {
+                pad = _capacity - _tail;
+                pos = 0;
+            }
+            while(_used + pad + stride > _budget) {
+                remove();
+                if(_size == 0) {
+                    pos = 0;
+                    pad = 0;
+                }
+            }
+
+            if(pad != 0)
+                store(_tail, wrap_marker);
+            store(pos, static_cast<std::uint32_t>(body));
+            size_type p = pos + header;
+            for(std::string_view f : fields) {
+                store(p, static_cast<std::uint32_t>(f.size()));
+                if(!f.empty())
+                    std::memcpy(_data + p + header, f.data(), f.size());
+                p += header + static_cast<size_type>(f.size());
+            }
+            _tail = pos + stride;
+            if(_tail == _capacity)
+                _tail = 0;
+            _used += pad + stride;
+            _size++;
+        }
+
+        /**
+         * @brief Inserimento di un record di un solo campo
+         *
+         * @param field Il contenuto del record
+         * @throw std::length_error se il record supera il budget
+        **/
+        void insert(std::string_view field) {
+            insert({field});
+        }
+
+        /**
+         * @brief Rimozione del record più vecchio
+        **/
+        void remove() {
+            if(_size == 0)
+                return;
+            const size_type pos = next(_head);
+            _used -= (pos > _head) ? pos - _head : _capacity - _head;
+            _head = pos;
+            if(--_size == 0)
+                _head = _tail = _used = 0;
+        }
+
+        /**
+         * @brief Svuotamento del buffer
+        **/
+        void clear() {
+            _head = _tail = _used = 0;
+            _size = 0;
+        }
+
+        /**
+         * @brief Record più vecchio
+         *
+         * @pre Il buffer non deve essere vuoto
+        **/
+        record_view front() const {
+            assert(_size != 0);
+            return view(_head);
+        }
+
+        /**
+         * @brief Iteratore in avanti sui record, dal più vecchio al più recente
+        **/
+        class const_iterator {
+            public:
+                typedef std::forward_iterator_tag iterator_category;
+                typedef record_view               value_type;
+                typedef std::ptrdiff_t            difference_type;
+                typedef const record_view*        pointer;
+                typedef record_view               reference;
+
+                const_iterator() : _cb(0), _pos(0), _left(0) {
+                }
+
+                record_view operator*() const {
+                    return _cb->view(_pos);
+                }
+
+                const_iterator &operator++() {
+                    _left--;
+                    if(_left != 0)
+                        _pos = _cb->next(_pos);
+                    return *this;
+                }
+
+                const_iterator operator++(int) {
+                    const_iterator tmp(*this);
+                    ++*this;
+                    return tmp;
+                }
+
+                bool operator==(const const_iterator &other) const {
+                    return _left == other._left;
+                }
+
+                bool operator!=(const const_iterator &other) const {
+                    return !(*this == other);
+                }
+
+            private:
+                const record_cbuffer *_cb;
+                size_type _pos;
+                size_type _left;  // record ancora da visitare
+
+                friend class record_cbuffer;
+
+                const_iterator(const record_cbuffer *cb, size_type pos, size_type left)
+                    : _cb(cb), _pos(pos), _left(left) {
+                }
+        };
+
+        const_iterator begin() const {
+            return const_iterator(this, _head, _size);
+        }
+
+        const_iterator end() const {
+            return const_iterator(this, _tail, 0);
+        }
+
+    private:
+        static const size_type header = sizeof(std::uint32_t);
+        static const std::uint32_t wrap_marker = 0xffffffffu;
+
+        char *_data;
+        size_type _capacity;
+        size_type _budget;
+        size_type _head;   // primo byte del record più vecchio
+        size_type _tail;   // primo byte libero
+        size_type _used;   // byte occupati, padding compreso
+        size_type _size;
+
+        //Non supportate
+        record_cbuffer(const record_cbuffer &other);
+        record_cbuffer &operator=(const record_cbuffer &other);
+
+        static size_type align(size_type n) {
+            return (n + header - 1) & ~(header - 1);
+        }
+
+        std::uint32_t load(size_type pos) const {
+            std::uint32_t n;
+            std::memcpy(&n, _data + pos, sizeof(n));
+            return n;
+        }
+
+        void store(size_type pos, std::uint32_t n) {
+            std::memcpy(_data + pos, &n, sizeof(n));
+        }
+
+        record_view view(size_type pos) const {
+            return record_view(_data + pos + header, load(pos));
+        }
+
+        static std::size_t body_bytes(std::initializer_list<std::string_view> fields) {
+            std::size_t bytes = 0;
+            for(std::string_view f : fields)
+                bytes += header + f.size();
+            return bytes;
+        }
+
+        //Posizione del record che segue quello in pos, saltando il padding di fine area
+        size_type next(size_type pos) const {
+            pos += align(header + load(pos));
+            if(pos == _capacity || load(pos) == wrap_marker)
+                return 0;
+            return pos;
+        }
+};
+
+#endif
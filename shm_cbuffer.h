@@ -0,0 +1,253 @@
+#ifndef SHM_CBUFFER_H
+#define SHM_CBUFFER_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>      // std::size_t
+#include <cstdint>      // std::uint32_t, std::uint64_t
+#include <cstring>      // std::memcpy
+#include <stdexcept>
+#include <string>
+#include <system_error> // std::system_error
+#include <type_traits>
+#include <fcntl.h>      // O_*
+#include <sys/mman.h>   // shm_open, shm_unlink, mmap, munmap
+#include <sys/stat.h>   // fstat
+#include <unistd.h>     // ftruncate, close
+
+/**
+ * @file shm_cbuffer.h
+ * @brief Dichiarazione della classe shm_cbuffer
+ *
+ * Buffer circolare lock-free produttore singolo / consumatore singolo in memoria condivisa
+ * POSIX, per lo scambio di elementi banalmente copiabili tra processi diversi.
+ * Il blocco di controllo e gli elementi stanno nello stesso segmento; la posizione degli
+ * elementi è salvata come offset dall'inizio del segmento, quindi ogni processo può
+ * mapparlo a un indirizzo diverso.
+**/
+
+#ifndef CBUFFER_CACHE_LINE
+#define CBUFFER_CACHE_LINE 64
+#endif
+
+template <class T>
+class shm_cbuffer {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "shm_cbuffer richiede un tipo banalmente copiabile");
+    static_assert(std::atomic<std::uint32_t>::is_always_lock_free &&
+                  std::atomic<std::uint64_t>::is_always_lock_free,
+                  "shm_cbuffer richiede atomici lock-free");
+
+    public:
+        typedef unsigned int size_type;
+
+        /**
+         * @brief Costruttore di creazione
+         *
+         * Crea (o ricrea) il segmento di memoria condivisa name per capacity elementi.
+         * Da usare nel processo che crea il canale.
+         * @param name Nome POSIX del segmento, ad esempio "/telemetria"
+         * @param capacity Numero massimo di elementi contenuti
+         * @throw std::system_error se il segmento non può essere creato o mappato
+        **/
+        shm_cbuffer(const std::string &name, size_type capacity) : _control(0), _bytes(0), _data(0),
+                _slots(capacity + 1), _head_cache(0), _tail_cache(0) {
+            const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+            if(fd < 0)
+                throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+            _bytes = data_offset() + std::size_t(_slots) * sizeof(T);
+            if(ftruncate(fd, _bytes) != 0) {
+                const int err = errno;
+                close(fd);
+                throw std::system_error(err, std::generic_category(), "ftruncate " + name);
+            }
+            map(fd, name);
+
+            _control->version = version_value;
+            _control->element_size = sizeof(T);
+            _control->slots = _slots;
+            _control->data_offset = data_offset();
+            _control->head.store(0, std::memory_order_relaxed);
+            _control->tail.store(0, std::memory_order_relaxed);
+            //Pubblicato per ultimo: chi legge il magic vede l'intestazione completa
+            _control->magic.store(magic_value, std::memory_order_release);
+            _data = reinterpret_cast<T*>(reinterpret_cast<char*>(_control) + _control->data_offset);
+        }
+
+        /**
+         * @brief Costruttore di collegamento
+         *
+         * Si collega a un segmento già creato da un altro processo.
+         * @param name Nome POSIX del segmento
+         * @throw std::system_error se il segmento non esiste o non può essere mappato
+         * @throw std::runtime_error se il segmento non è (ancora) inizializzato o il tipo è diverso
+        **/
+        explicit shm_cbuffer(const std::string &name) : _control(0), _bytes(0), _data(0),
+                _slots(0), _head_cache(0), _tail_cache(0) {
+            const int fd = shm_open(name.c_str(), O_RDWR, 0600);
+            if(fd < 0)
+                throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+            struct stat st;
+            if(fstat(fd, &st) != 0) {
+                const int err = errno;
+                close(fd);
+                throw std::system_error(err, std::generic_category(), "fstat " + name);
+            }
+            _bytes = st.st_size;
+            if(_bytes < sizeof(control)) {
+                close(fd);
+                throw std::runtime_error("shm_cbuffer: segmento non inizializzato " + name);
+            }
+            map(fd, name);
+
+            //Il magic va letto prima degli altri campi, che sono validi solo dopo la sua pubblicazione
+            if(_control->magic.load(std::memory_order_acquire) != magic_value) {
+                munmap(_control, _bytes);
+                throw std::runtime_error("shm_cbuffer: segmento non inizializzato " + name);
+            }
+            if(_control->version != version_value || _control->element_size != sizeof(T) ||
+               _control->data_offset + std::size_t(_control->slots) * sizeof(T) > _bytes) {
+                munmap(_control, _bytes);
+                throw std::runtime_error("shm_cbuffer: segmento incompatibile " + name);
+            }
+            _slots = _control->slots;
+            _data = reinterpret_cast<T*>(reinterpret_cast<char*>(_control) + _control->data_offset);
+            _head_cache = _control->head.load(std::memory_order_acquire);
+            _tail_cache = _control->tail.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief Distruttore
+         *
+         * Rimuove la mappatura del processo corrente. Il segmento resta finché non viene
+         * chiamata unlink().
+        **/
+        ~shm_cbuffer() {
+            if(_control != 0)
+                munmap(_control, _bytes);
+            _control = 0;
+        }
+
+        /**
+         * @brief Rimozione del nome del segmento
+         *
+         * Il segmento viene liberato quando tutti i processi lo hanno smappato.
+         * @param name Nome POSIX del segmento
+        **/
+        static void unlink(const std::string &name) {
+            shm_unlink(name.c_str());
+        }
+
+        /**
+         * @brief Inserimento non bloccante (solo produttore)
+         *
+         * @param value Un elemento da inserire
+         * @return true se l'elemento è stato inserito, false se il buffer è pieno
+        **/
+        bool try_push(const T &value) {
+            const size_type tail = _control->tail.load(std::memory_order_relaxed);
+            const size_type next = advance(tail);
+            if(next == _head_cache) {
+                _head_cache = _control->head.load(std::memory_order_acquire);
+                if(next == _head_cache)
+                    return false;
+            }
+            std::memcpy(static_cast<void*>(_data + tail), &value, sizeof(T));
+            _control->tail.store(next, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Estrazione non bloccante (solo consumatore)
+         *
+         * @param value Reference in cui viene copiato l'elemento estratto
+         * @return true se un elemento è stato estratto, false se il buffer è vuoto
+        **/
+        bool try_pop(T &value) {
+            const size_type head = _control->head.load(std::memory_order_relaxed);
+            if(head == _tail_cache) {
+                _tail_cache = _control->tail.load(std::memory_order_acquire);
+                if(head == _tail_cache)
+                    return false;
+            }
+            std::memcpy(static_cast<void*>(&value), _data + head, sizeof(T));
+            _control->head.store(advance(head), std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Capacità del buffer
+         *
+         * @return Il numero massimo di elementi contenuti
+        **/
+        size_type capacity() const {
+            return _slots - 1;
+        }
+
+        /**
+         * @brief Dimensione del buffer
+         *
+         * @return Una stima del numero di elementi presenti
+        **/
+        size_type size() const {
+            const size_type head = _control->head.load(std::memory_order_acquire);
+            const size_type tail = _control->tail.load(std::memory_order_acquire);
+            return (tail >= head) ? tail - head : _slots - head + tail;
+        }
+
+    private:
+        //Non copiabile: possiede la mappatura
+        shm_cbuffer(const shm_cbuffer &other);
+        shm_cbuffer &operator=(const shm_cbuffer &other);
+
+        static const std::uint64_t magic_value = 0x5245464655424353ULL; // "SCBUFFER"
+        static const std::uint32_t version_value = 1;
+
+        /**
+         * Blocco di controllo all'inizio del segmento. Nessun puntatore: gli elementi
+         * si trovano a data_offset byte dall'inizio del segmento.
+        **/
+        struct control {
+            std::atomic<std::uint64_t> magic;  // scritto per ultimo dal creatore
+            std::uint32_t version;
+            std::uint32_t element_size;
+            std::uint32_t slots;
+            std::uint32_t reserved;
+            std::uint64_t data_offset;
+            alignas(CBUFFER_CACHE_LINE) std::atomic<std::uint32_t> head;
+            alignas(CBUFFER_CACHE_LINE) std::atomic<std::uint32_t> tail;
+        };
+
+        control* _control;
+        std::size_t _bytes;
+        T* _data;
+        size_type _slots;
+
+        //Copie locali degli indici dell'altro processo
+        size_type _head_cache;
+        size_type _tail_cache;
+
+        //Posizione degli elementi nel segmento
+        static std::size_t data_offset() {
+            const std::size_t align = (alignof(T) > CBUFFER_CACHE_LINE) ? alignof(T) : CBUFFER_CACHE_LINE;
+            return (sizeof(control) + align - 1) / align * align;
+        }
+
+        //Mappa il segmento aperto e chiude il descrittore
+        void map(int fd, const std::string &name) {
+            void *base = mmap(0, _bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            const int err = errno;
+            close(fd);
+            if(base == MAP_FAILED)
+                throw std::system_error(err, std::generic_category(), "mmap " + name);
+            _control = static_cast<control*>(base);
+        }
+
+        //Indice fisico successivo, senza modulo
+        size_type advance(size_type i) const {
+            ++i;
+            return (i == _slots) ? 0 : i;
+        }
+};
+
+#endif
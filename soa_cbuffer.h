@@ -0,0 +1,414 @@
+#ifndef SOA_CBUFFER_H
+#define SOA_CBUFFER_H
+
+#include <cassert>
+#include <cstddef>     // std::size_t
+#include <memory>      // std::allocator
+#include <new>         // placement new
+#include <ostream>     // std::ostream
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>     // std::pair, std::forward, std::index_sequence
+#include "cbuffer_algo.h"
+
+/**
+ * @file soa_cbuffer.h
+ * @brief Dichiarazione della classe soa_cbuffer
+ *
+ * Buffer circolare di record memorizzati per colonne (structure of arrays): ogni campo
+ * del record ha il proprio array, e tutti gli array condividono la stessa testa e dimensione.
+ * Una scansione che legge un solo campo (ad esempio il cognome di una person) porta in cache
+ * solo quella colonna, e sulle colonne int e float i predicati threshold sono vettoriali.
+**/
+
+/**
+ * @brief Tipo del record e del campo di un puntatore a membro
+**/
+template <class M>
+struct soa_member;
+
+template <class R, class F>
+struct soa_member<F R::*> {
+    typedef R record_type;
+    typedef F type;
+};
+
+/**
+ * @brief Buffer circolare di record per colonne
+ *
+ * Le colonne sono elencate come puntatori a membro di Record, ad esempio
+ * soa_cbuffer<person, &person::name, &person::surname>. Una riga si ricompone
+ * con Record{campo_0, ..., campo_n-1}. Come cbuffer, se il buffer è pieno
+ * l'inserimento sovrascrive la riga più vecchia.
+ * La copia non è supportata.
+**/
+template <class Record, auto... Members>
+class soa_cbuffer {
+    static_assert(sizeof...(Members) != 0, "soa_cbuffer richiede almeno una colonna");
+    static_assert((std::is_same<typename soa_member<decltype(Members)>::record_type, Record>::value && ...),
+                  "le colonne di soa_cbuffer devono essere membri di Record");
+
+    public:
+        typedef unsigned int size_type;
+
+        /**
+         * @brief Tipo della colonna I
+        **/
+        template <std::size_t I>
+        using column_type = typename soa_member<
+            typename std::tuple_element<I, std::tuple<decltype(Members)...> >::type>::type;
+
+        template <std::size_t I>
+        using column_range = std::pair<column_type<I>*, size_type>;
+
+        template <std::size_t I>
+        using const_column_range = std::pair<const column_type<I>*, size_type>;
+
+        template <bool Const>
+        class basic_row;
+
+        typedef basic_row<false> row;
+        typedef basic_row<true> const_row;
+
+        static const std::size_t columns = sizeof...(Members);
+
+        /**
+         * @brief Riga del buffer
+         *
+         * Riferimento a una riga: i campi si leggono e modificano con get<I>(), la
+         * conversione a Record ricompone una copia della riga. È valida finché la
+         * riga non viene rimossa o sovrascritta.
+        **/
+        template <bool Const>
+        class basic_row {
+            typedef typename std::conditional<Const, const soa_cbuffer, soa_cbuffer>::type owner_type;
+
+            public:
+                /**
+                 * @brief Campo I della riga
+                **/
+                template <std::size_t I>
+                typename std::conditional<Const, const column_type<I>&, column_type<I>&>::type get() const {
+                    return std::get<I>(_cb->_columns)[_slot];
+                }
+
+                /**
+                 * @brief Copia della riga come Record
+                **/
+                operator Record() const {
+                    return make_record(std::make_index_sequence<columns>());
+                }
+
+                /**
+                 * @brief Operatore di stream in output
+                 *
+                 * Stampa la riga con l'operatore << di Record.
+                **/
+                friend std::ostream &operator<<(std::ostream &os, const basic_row &r) {
+                    return os << static_cast<Record>(r);
+                }
+
+            private:
+                owner_type *_cb;
+                size_type _slot;
+
+                friend class soa_cbuffer;
+
+                basic_row(owner_type *cb, size_type slot) : _cb(cb), _slot(slot) {
+                }
+
+                template <std::size_t... I>
+                Record make_record(std::index_sequence<I...>) const {
+                    return Record{get<I>()...};
+                }
+        };
+
+        /**
+         * @brief Costruttore secondario
+         *
+         * Alloca una colonna di capacity elementi per ogni campo.
+         * @param capacity capacità del buffer
+         * @throw Eccezione di allocazione memoria
+        **/
+        explicit soa_cbuffer(size_type capacity) : _columns(), _capacity(0), _head(0), _size(0) {
+            allocate(capacity, indices());
+        }
+
+        /**
+         * @brief Distruttore
+        **/
+        ~soa_cbuffer() {
+            clear();
+            deallocate(indices());
+        }
+
+        size_type capacity() const {
+            return _capacity;
+        }
+
+        size_type size() const {
+            return _size;
+        }
+
+        /**
+         * @brief Inserimento di un record
+         *
+         * Copia i campi del record in coda, ciascuno nella propria colonna.
+         * Se il buffer è pieno la riga più vecchia viene sovrascritta per assegnamento.
+         * @param r Il record da inserire
+        **/
+        void insert(const Record &r) {
+            emplace(r.*Members...);
+        }
+
+        /**
+         * @brief Inserimento di una riga campo per campo
+         *
+         * @param fields Un valore per ogni colonna, nell'ordine delle colonne
+        **/
+        template <typename... Args>
+        void emplace(Args&&... fields) {
+            static_assert(sizeof...(Args) == columns, "soa_cbuffer::emplace richiede un valore per colonna");
+            if(_capacity == 0)
+                return;
+            if(_size == _capacity) {
+                assign_row(_head, indices(), std::forward<Args>(fields)...);
+                _head = wrap(_head + 1);
+            }
+            else {
+                construct_row<0>(wrap(_head + _size), std::forward<Args>(fields)...);
+                _size++;
+            }
+        }
+
+        /**
+         * @brief Rimozione della riga più vecchia
+        **/
+        void remove() {
+            if(_size != 0) {
+                destroy_row(_head, indices());
+                _head = wrap(_head + 1);
+                _size--;
+            }
+        }
+
+        /**
+         * @brief Svuotamento del buffer
+        **/
+        void clear() {
+            if(!trivially_destructible)
+                for(size_type i = 0; i < _size; i++)
+                    destroy_row(wrap(_head + i), indices());
+            _head = 0;
+            _size = 0;
+        }
+
+        /**
+         * @brief Accesso alla riga index-esima
+         *
+         * @pre index < size()
+        **/
+        row operator[](size_type index) {
+            assert(index < _size);
+            return row(this, wrap(_head + index));
+        }
+
+        const_row operator[](size_type index) const {
+            assert(index < _size);
+            return const_row(this, wrap(_head + index));
+        }
+
+        /**
+         * @brief Accesso controllato alla riga index-esima
+         *
+         * @throw std::out_of_range se index >= size()
+        **/
+        row at(size_type index) {
+            if(index >= _size)
+                throw std::out_of_range("Index out of range");
+            return row(this, wrap(_head + index));
+        }
+
+        const_row at(size_type index) const {
+            if(index >= _size)
+                throw std::out_of_range("Index out of range");
+            return const_row(this, wrap(_head + index));
+        }
+
+        /**
+         * @brief Riga più vecchia
+         *
+         * @pre Il buffer non deve essere vuoto
+        **/
+        const_row front() const {
+            assert(_size != 0);
+            return const_row(this, _head);
+        }
+
+        /**
+         * @brief Riga più recente
+         *
+         * @pre Il buffer non deve essere vuoto
+        **/
+        const_row back() const {
+            assert(_size != 0);
+            return const_row(this, wrap(_head + _size - 1));
+        }
+
+        /**
+         * @brief Primo blocco contiguo della colonna I
+         *
+         * Come cbuffer::array_one, ma per un solo campo.
+         * @return Coppia puntatore al campo della riga in testa, numero di righe
+        **/
+        template <std::size_t I>
+        column_range<I> column_one() {
+            return column_range<I>(std::get<I>(_columns) + _head, one_size());
+        }
+
+        template <std::size_t I>
+        const_column_range<I> column_one() const {
+            return const_column_range<I>(std::get<I>(_columns) + _head, one_size());
+        }
+
+        /**
+         * @brief Secondo blocco contiguo della colonna I
+         *
+         * @return Coppia puntatore al primo slot della colonna, numero di righe (eventualmente 0)
+        **/
+        template <std::size_t I>
+        column_range<I> column_two() {
+            return column_range<I>(std::get<I>(_columns), _size - one_size());
+        }
+
+        template <std::size_t I>
+        const_column_range<I> column_two() const {
+            return const_column_range<I>(std::get<I>(_columns), _size - one_size());
+        }
+
+        /**
+         * @brief Conteggio delle righe il cui campo I soddisfa un predicato
+         *
+         * Scandisce solo la colonna I, con gli stessi kernel di cbuffer_algo.h:
+         * vettoriali per i predicati threshold su colonne int e float.
+         * @param pred predicato unario sul campo
+         * @return Il numero di righe che soddisfano il predicato
+        **/
+        template <std::size_t I, typename P>
+        size_type count_if(P pred) const {
+            cbuffer_simd::count_visitor visit = {0};
+            scan<I>(pred, visit);
+            return static_cast<size_type>(visit.count);
+        }
+
+        /**
+         * @brief Ricerca della prima riga il cui campo I soddisfa un predicato
+         *
+         * @param pred predicato unario sul campo
+         * @return L'indice logico della prima riga trovata, size() se non esiste
+        **/
+        template <std::size_t I, typename P>
+        size_type find_if(P pred) const {
+            cbuffer_simd::find_visitor visit = {_size, false};
+            scan<I>(pred, visit);
+            return static_cast<size_type>(visit.found);
+        }
+
+    private:
+        typedef std::make_index_sequence<sizeof...(Members)> indices;
+
+        static const bool trivially_destructible =
+            (std::is_trivially_destructible<typename soa_member<decltype(Members)>::type>::value && ...);
+
+        std::tuple<typename soa_member<decltype(Members)>::type*...> _columns;
+        size_type _capacity;
+        size_type _head;
+        size_type _size;
+
+        //Non supportate
+        soa_cbuffer(const soa_cbuffer &other);
+        soa_cbuffer &operator=(const soa_cbuffer &other);
+
+        size_type wrap(size_type i) const {
+            return (i >= _capacity) ? i - _capacity : i;
+        }
+
+        //Righe del primo blocco contiguo
+        size_type one_size() const {
+            return (_size < _capacity - _head) ? _size : _capacity - _head;
+        }
+
+        template <std::size_t... I>
+        void allocate(size_type capacity, std::index_sequence<I...>) {
+            _capacity = capacity;
+            if(capacity == 0)
+                return;
+            try {
+                ((std::get<I>(_columns) = std::allocator<column_type<I> >().allocate(capacity)), ...);
+            }
+            catch(...) {
+                deallocate(indices());
+                throw;
+            }
+        }
+
+        template <std::size_t... I>
+        void deallocate(std::index_sequence<I...>) {
+            ((std::get<I>(_columns) != 0 ?
+                std::allocator<column_type<I> >().deallocate(std::get<I>(_columns), _capacity) : void()), ...);
+            ((std::get<I>(_columns) = 0), ...);
+        }
+
+        //Costruisce i campi dalla colonna I in poi; se un campo lancia, distrugge i precedenti
+        template <std::size_t I, typename Arg, typename... Rest>
+        void construct_row(size_type slot, Arg &&field, Rest&&... rest) {
+            ::new(static_cast<void*>(std::get<I>(_columns) + slot)) column_type<I>(std::forward<Arg>(field));
+            if constexpr(sizeof...(Rest) != 0) {
+                try {
+                    construct_row<I + 1>(slot, std::forward<Rest>(rest)...);
+                }
+                catch(...) {
+                    destroy(std::get<I>(_columns) + slot);
+                    throw;
+                }
+            }
+        }
+
+        template <std::size_t... I, typename... Args>
+        void assign_row(size_type slot, std::index_sequence<I...>, Args&&... fields) {
+            ((std::get<I>(_columns)[slot] = std::forward<Args>(fields)), ...);
+        }
+
+        template <std::size_t... I>
+        void destroy_row(size_type slot, std::index_sequence<I...>) {
+            (destroy(std::get<I>(_columns) + slot), ...);
+        }
+
+        template <typename F>
+        static void destroy(F *p) {
+            p->~F();
+        }
+
+        template <std::size_t I, typename P, typename V>
+        void scan(P &pred, V &visit) const {
+            const const_column_range<I> one = column_one<I>();
+            const const_column_range<I> two = column_two<I>();
+            if(cbuffer_simd::scan(one.first, one.second, 0, pred, visit))
+                cbuffer_simd::scan(two.first, two.second, one.second, pred, visit);
+        }
+};
+
+/**
+ * @brief Operatore di stream in output
+ *
+ * Stampa le righe dalla più vecchia alla più recente, come l'operatore << di cbuffer.
+**/
+template <class Record, auto... Members>
+std::ostream &operator<<(std::ostream &os, const soa_cbuffer<Record, Members...> &cb) {
+    for(typename soa_cbuffer<Record, Members...>::size_type i = 0; i < cb.size(); ++i)
+        os << cb[i] << " ";
+    return os;
+}
+
+#endif
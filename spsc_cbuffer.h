@@ -0,0 +1,149 @@
+#ifndef SPSC_CBUFFER_H
+#define SPSC_CBUFFER_H
+
+#include <atomic>
+#include <cstddef> // std::size_t
+#include <utility> // std::move
+
+/**
+ * @file spsc_cbuffer.h
+ * @brief Dichiarazione della classe spsc_cbuffer
+ *
+ * Buffer circolare lock-free per un solo produttore e un solo consumatore.
+ * Il produttore chiama try_push, il consumatore try_pop, senza alcun mutex.
+**/
+
+#ifndef CBUFFER_CACHE_LINE
+#define CBUFFER_CACHE_LINE 64
+#endif
+
+template <class T>
+class spsc_cbuffer {
+    public:
+        typedef unsigned int size_type;
+
+        /**
+         * @brief Costruttore secondario
+         *
+         * Costruttore che prende in input la capacità del buffer. Viene allocato
+         * uno slot in più per distinguere il buffer pieno dal buffer vuoto.
+         * @param capacity Numero massimo di elementi contenuti
+         * @throw Eccezione di allocazione memoria
+        **/
+        explicit spsc_cbuffer(size_type capacity) : _buffer(0), _slots(capacity + 1),
+                _head(0), _tail_cache(0), _tail(0), _head_cache(0) {
+            _buffer = new T[_slots];
+        }
+
+        /**
+         * @brief Distruttore
+         *
+         * Distruttore della classe spsc_cbuffer
+        **/
+        ~spsc_cbuffer() {
+            delete[] _buffer;
+            _buffer = 0;
+        }
+
+        /**
+         * @brief Inserimento non bloccante (solo produttore)
+         *
+         * Inserisce un elemento in coda al buffer, se c'è spazio.
+         * Wait-free: non attende mai il consumatore.
+         * @param value Un elemento da inserire
+         * @return true se l'elemento è stato inserito, false se il buffer è pieno
+        **/
+        bool try_push(const T &value) {
+            const size_type tail = _tail.load(std::memory_order_relaxed);
+            const size_type next = advance(tail);
+            if(next == _head_cache) {
+                _head_cache = _head.load(std::memory_order_acquire);
+                if(next == _head_cache)
+                    return false;
+            }
+            _buffer[tail] = value;
+            _tail.store(next, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Estrazione non bloccante (solo consumatore)
+         *
+         * Estrae l'elemento in testa al buffer, se presente.
+         * Wait-free: non attende mai il produttore.
+         * @param value Reference in cui viene spostato l'elemento estratto
+         * @return true se un elemento è stato estratto, false se il buffer è vuoto
+        **/
+        bool try_pop(T &value) {
+            const size_type head = _head.load(std::memory_order_relaxed);
+            if(head == _tail_cache) {
+                _tail_cache = _tail.load(std::memory_order_acquire);
+                if(head == _tail_cache)
+                    return false;
+            }
+            value = std::move(_buffer[head]);
+            _head.store(advance(head), std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Capacità del buffer
+         *
+         * @return Il numero massimo di elementi contenuti
+        **/
+        size_type capacity() const {
+            return _slots - 1;
+        }
+
+        /**
+         * @brief Dimensione del buffer
+         *
+         * Ritorna una stima del numero di elementi presenti. Il valore è esatto
+         * solo se letto dal produttore o dal consumatore a buffer fermo.
+         * @return Il numero di elementi presenti
+        **/
+        size_type size() const {
+            const size_type head = _head.load(std::memory_order_acquire);
+            const size_type tail = _tail.load(std::memory_order_acquire);
+            return (tail >= head) ? tail - head : _slots - head + tail;
+        }
+
+        /**
+         * @brief Buffer vuoto
+         *
+         * @return true se il buffer non contiene elementi
+        **/
+        bool empty() const {
+            return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+        }
+
+    private:
+        //Non copiabile: gli indici atomici appartengono ai due thread
+        spsc_cbuffer(const spsc_cbuffer &other);
+        spsc_cbuffer &operator=(const spsc_cbuffer &other);
+
+        T* _buffer;
+        size_type _slots;
+
+        //Lato consumatore: indice di testa e copia locale dell'indice di coda
+        alignas(CBUFFER_CACHE_LINE) std::atomic<size_type> _head;
+        size_type _tail_cache;
+
+        //Lato produttore: indice di coda e copia locale dell'indice di testa
+        alignas(CBUFFER_CACHE_LINE) std::atomic<size_type> _tail;
+        size_type _head_cache;
+
+        /**
+         * @brief Indice fisico successivo
+         *
+         * Avanza un indice fisico senza usare l'operatore modulo.
+         * @param i indice fisico
+         * @return indice fisico successivo
+        **/
+        size_type advance(size_type i) const {
+            ++i;
+            return (i == _slots) ? 0 : i;
+        }
+};
+
+#endif
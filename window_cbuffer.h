@@ -0,0 +1,312 @@
+#ifndef WINDOW_CBUFFER_H
+#define WINDOW_CBUFFER_H
+
+#include <cmath>       // std::sqrt
+#include <stdexcept>
+#include <type_traits>
+#include <utility>     // std::pair
+#include <vector>
+#include "cbuffer.h"
+
+/**
+ * @file window_cbuffer.h
+ * @brief Dichiarazione delle classi window_stats e window_aggregate
+ *
+ * Finestre scorrevoli basate su cbuffer che mantengono le statistiche degli elementi
+ * presenti aggiornandole a ogni inserimento, rimozione o sovrascrittura, invece di
+ * ricalcolarle scandendo tutto il buffer (O(1) ammortizzato invece di O(capacità)).
+**/
+
+/**
+ * @brief Finestra scorrevole con somma, media, varianza, minimo e massimo
+ *
+ * La somma è esatta per i tipi interi (long long) e in double per gli altri.
+ * Media e varianza sono aggiornate con l'algoritmo di Welford, anche in rimozione.
+ * Minimo e massimo sono mantenuti con due deque monotone di coppie (valore, sequenza),
+ * a loro volta cbuffer della stessa capacità della finestra.
+**/
+template <class T>
+class window_stats {
+    public:
+        typedef typename cbuffer<T>::size_type size_type;
+        typedef typename std::conditional<std::is_integral<T>::value, long long, double>::type sum_type;
+
+        /**
+         * @brief Costruttore secondario
+         *
+         * @param capacity Dimensione della finestra
+        **/
+        explicit window_stats(size_type capacity) : _window(capacity), _min(capacity), _max(capacity),
+                _seq(0), _sum(0), _mean(0), _m2(0) {
+        }
+
+        /**
+         * @brief Inserimento di un campione
+         *
+         * Se la finestra è piena il campione più vecchio viene sovrascritto e
+         * le statistiche lo escludono.
+         * @param value Un elemento da inserire
+        **/
+        void insert(const T &value) {
+            if(_window.capacity() == 0)
+                return;
+            if(_window.size() == _window.capacity())
+                evict();
+            _window.insert(value);
+            add(value);
+        }
+
+        /**
+         * @brief Rimozione del campione più vecchio
+        **/
+        void remove() {
+            if(_window.size() != 0) {
+                evict();
+                _window.remove();
+            }
+        }
+
+        /**
+         * @brief Svuotamento della finestra
+        **/
+        void clear() {
+            _window.clear();
+            _min.clear();
+            _max.clear();
+            _sum = 0;
+            _mean = 0;
+            _m2 = 0;
+        }
+
+        /**
+         * @brief Elementi della finestra
+         *
+         * @return Il cbuffer con i campioni presenti, dal più vecchio al più recente
+        **/
+        const cbuffer<T> &window() const {
+            return _window;
+        }
+
+        size_type size() const {
+            return _window.size();
+        }
+
+        size_type capacity() const {
+            return _window.capacity();
+        }
+
+        /**
+         * @brief Somma dei campioni presenti
+        **/
+        sum_type sum() const {
+            return _sum;
+        }
+
+        /**
+         * @brief Media dei campioni presenti
+         *
+         * @return La media, 0 se la finestra è vuota
+        **/
+        double mean() const {
+            return _mean;
+        }
+
+        /**
+         * @brief Varianza dei campioni presenti
+         *
+         * @return La varianza della popolazione, 0 se la finestra è vuota
+        **/
+        double variance() const {
+            return (_window.size() != 0) ? _m2 / _window.size() : 0;
+        }
+
+        /**
+         * @brief Deviazione standard dei campioni presenti
+        **/
+        double stddev() const {
+            return std::sqrt(variance());
+        }
+
+        /**
+         * @brief Minimo dei campioni presenti
+         *
+         * @throw std::out_of_range se la finestra è vuota
+        **/
+        const T &min() const {
+            if(_min.size() == 0)
+                throw std::out_of_range("Empty window");
+            return _min.front().first;
+        }
+
+        /**
+         * @brief Massimo dei campioni presenti
+         *
+         * @throw std::out_of_range se la finestra è vuota
+        **/
+        const T &max() const {
+            if(_max.size() == 0)
+                throw std::out_of_range("Empty window");
+            return _max.front().first;
+        }
+
+    private:
+        typedef std::pair<T, unsigned long> entry;
+
+        cbuffer<T> _window;
+        cbuffer<entry> _min;   // valori crescenti dalla testa alla coda
+        cbuffer<entry> _max;   // valori decrescenti dalla testa alla coda
+        unsigned long _seq;    // numero di sequenza del prossimo campione
+        sum_type _sum;
+        double _mean;
+        double _m2;            // somma dei quadrati degli scarti dalla media
+
+        //Aggiunge il campione più recente alle statistiche
+        void add(const T &value) {
+            _sum += value;
+            const size_type n = _window.size();
+            const double delta = value - _mean;
+            _mean += delta / n;
+            _m2 += delta * (value - _mean);
+
+            while(_min.size() != 0 && !(_min.back().first < value))
+                _min.remove_back();
+            _min.insert(entry(value, _seq));
+            while(_max.size() != 0 && !(value < _max.back().first))
+                _max.remove_back();
+            _max.insert(entry(value, _seq));
+            _seq++;
+        }
+
+        //Esclude dalle statistiche il campione più vecchio, prima che venga rimosso
+        void evict() {
+            const T &value = _window.front();
+            _sum -= value;
+            const size_type n = _window.size() - 1;
+            if(n == 0) {
+                _mean = 0;
+                _m2 = 0;
+            }
+            else {
+                const double delta = value - _mean;
+                _mean -= delta / n;
+                _m2 -= delta * (value - _mean);
+                if(_m2 < 0)
+                    _m2 = 0;
+            }
+
+            //Numero di sequenza del campione più vecchio
+            const unsigned long oldest = _seq - _window.size();
+            if(_min.size() != 0 && _min.front().second == oldest)
+                _min.remove();
+            if(_max.size() != 0 && _max.front().second == oldest)
+                _max.remove();
+        }
+};
+
+/**
+ * @brief Finestra scorrevole con un'operazione associativa definita dall'utente
+ *
+ * Mantiene op(x_0, ..., x_n-1) sui campioni presenti con lo schema a due pile: gli elementi
+ * più vecchi formano la pila di uscita, per la quale sono memorizzati gli aggregati dei
+ * suffissi; quelli più recenti la pila di ingresso, di cui basta l'aggregato complessivo.
+ * Quando la pila di uscita si svuota gli aggregati vengono ricalcolati in un'unica passata,
+ * quindi ogni operazione costa O(1) ammortizzato. Non è necessario che Op sia commutativa
+ * né invertibile; deve essere associativa (ad esempio massimo comun divisore, composizione
+ * di funzioni affini).
+**/
+template <class T, class Op>
+class window_aggregate {
+    public:
+        typedef typename cbuffer<T>::size_type size_type;
+
+        /**
+         * @brief Costruttore secondario
+         *
+         * @param capacity Dimensione della finestra
+         * @param op Operazione associativa
+        **/
+        explicit window_aggregate(size_type capacity, Op op = Op()) : _window(capacity), _op(op),
+                _front(), _front_pos(0), _back(), _back_size(0) {
+            _front.reserve(capacity);
+        }
+
+        /**
+         * @brief Inserimento di un campione
+         *
+         * Se la finestra è piena il campione più vecchio viene sovrascritto.
+         * @param value Un elemento da inserire
+        **/
+        void insert(const T &value) {
+            if(_window.capacity() == 0)
+                return;
+            if(_window.size() == _window.capacity())
+                evict();
+            _window.insert(value);
+            if(_back_size == 0)
+                _back = value;
+            else
+                _back = _op(_back, value);
+            _back_size++;
+        }
+
+        /**
+         * @brief Rimozione del campione più vecchio
+        **/
+        void remove() {
+            if(_window.size() != 0) {
+                evict();
+                _window.remove();
+            }
+        }
+
+        /**
+         * @brief Elementi della finestra
+        **/
+        const cbuffer<T> &window() const {
+            return _window;
+        }
+
+        size_type size() const {
+            return _window.size();
+        }
+
+        /**
+         * @brief Aggregato dei campioni presenti
+         *
+         * @return op applicata ai campioni dal più vecchio al più recente
+         * @throw std::out_of_range se la finestra è vuota
+        **/
+        T value() const {
+            if(_window.size() == 0)
+                throw std::out_of_range("Empty window");
+            if(_front_pos == _front.size())
+                return _back;
+            if(_back_size == 0)
+                return _front[_front_pos];
+            return _op(_front[_front_pos], _back);
+        }
+
+    private:
+        cbuffer<T> _window;
+        Op _op;
+        std::vector<T> _front;   // aggregati dei suffissi della pila di uscita
+        size_type _front_pos;    // suffisso che inizia dal campione più vecchio
+        T _back;                 // aggregato della pila di ingresso
+        size_type _back_size;
+
+        //Toglie il campione più vecchio dalla pila di uscita, travasando se è vuota
+        void evict() {
+            if(_front_pos == _front.size()) {
+                const size_type n = _window.size();
+                _front.resize(n);
+                _front[n - 1] = _window[n - 1];
+                for(size_type i = n - 1; i != 0; i--)
+                    _front[i - 1] = _op(_window[i - 1], _front[i]);
+                _front_pos = 0;
+                _back_size = 0;
+            }
+            _front_pos++;
+        }
+};
+
+#endif